@@ -0,0 +1,70 @@
+#include <array>
+#include <iostream>
+#include <span>
+#include <string>
+
+#include <sys/epoll.h>
+#include <unistd.h>
+
+#include "rpi_sound/detached_task.hpp"
+#include "rpi_sound/player.hpp"
+#include "rpi_sound/tiny_alsa_wrapper.hpp"
+
+// Plays the given files one after another from a single epoll loop that
+// also serves stdin. Only the file reading runs on the player's loader thread.
+// usage: play_async <card> <device> <file>...
+namespace {
+    DetachedTask playAll(Player& player, std::span<char*> files, bool& isDone) {
+        for (auto* file : files) {
+            std::cout << "Playing " << file << "\r\n";
+            if (!co_await player.playAsync(file)) {
+                std::cout << "Skipped " << file << "\r\n";
+            }
+        }
+        isDone = true;
+    }
+}
+
+int main(int argc, char* argv[]) {
+
+    std::span<char*> args(argv, argc);
+    if (args.size() < 4) {
+        std::cout << "usage: play_async <card> <device> <file>...\r\n";
+        return -1;
+    }
+
+    Player player{std::make_unique<TinyAlsaWrapper>(true)};
+    auto format = TinyAlsaWrapper{}.getDefaultFormat();
+    if (!player.open(std::stoi(args[1]), std::stoi(args[2]), format)) {
+        return -1;
+    }
+
+    auto epollFd = epoll_create1(EPOLL_CLOEXEC);
+    epoll_event audioEvent{.events = EPOLLOUT, .data = {.fd = player.pollFd()}};
+    epoll_event inputEvent{.events = EPOLLIN, .data = {.fd = STDIN_FILENO}};
+    if (epollFd < 0 ||
+        epoll_ctl(epollFd, EPOLL_CTL_ADD, player.pollFd(), &audioEvent) != 0 ||
+        epoll_ctl(epollFd, EPOLL_CTL_ADD, STDIN_FILENO, &inputEvent) != 0) {
+        std::cout << "epoll setup failed!\r\n";
+        return -1;
+    }
+
+    auto isDone{false};
+    playAll(player, args.subspan(3), isDone);
+
+    std::array<epoll_event, 4> events;
+    while (!isDone) {
+        auto count = epoll_wait(epollFd, events.data(), events.size(), -1);
+        for (auto i = 0; i < count; ++i) {
+            if (events[i].data.fd == STDIN_FILENO) {
+                std::string line;
+                std::getline(std::cin, line);
+                std::cout << "Still responsive: " << line << "\r\n";
+            } else {
+                player.onWritable();
+            }
+        }
+    }
+    close(epollFd);
+    return 0;
+}
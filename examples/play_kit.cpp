@@ -0,0 +1,95 @@
+#include <cstdlib>
+#include <iostream>
+#include <span>
+#include <string>
+#include <string_view>
+
+#include "rpi_sound/failover_device.hpp"
+#include "rpi_sound/kit_watcher.hpp"
+#include "rpi_sound/render_engine.hpp"
+#include "rpi_sound/tiny_alsa_wrapper.hpp"
+
+// Plays a kit directory (e.g. sound/demo) and reloads it whenever a sample
+// changes. Type an instrument name and press enter to trigger it, or "?"
+// to print the DSP load.
+// With a second argument of "adpcm" the samples are kept compressed in RAM,
+// with a number only that many ms of each sample stay in RAM and the rest
+// is streamed from disk.
+// If the output card disappears, playback continues on the headphone jack
+// until it is plugged back in.
+int main(int argc, char* argv[]) {
+
+    std::span<char*> args(argv, argc);
+    if (args.size() < 2) {
+        std::cout << "no kit directory provided.\r\n";
+        return -1;
+    }
+
+    auto device = std::make_unique<FailoverDevice>([]() { return std::make_unique<TinyAlsaWrapper>(); });
+    HWAudioFormat format{};
+    auto isOpened{false};
+    for (const auto& audioDevice : device->listDevices()) {
+        for (const auto& [deviceId, type, hwFormat] : audioDevice.device) {
+            if (!isOpened && type == AudioDevice::Type::kPlayback &&
+                device->setDevice(audioDevice.card, deviceId, type)) {
+                std::cout << "Playing on: Card " << audioDevice.card << " Device " << deviceId << "\r\n";
+                format = hwFormat;
+                isOpened = true;
+            }
+        }
+    }
+    if (!isOpened) {
+        std::cout << "No playback device.\r\n";
+        return -1;
+    }
+    constexpr auto kFallbackCard{"Headphones"};
+    if (!device->setFallback(kFallbackCard, 0)) {
+        std::cout << "No fallback, output stops if the card is lost.\r\n";
+    }
+
+    constexpr uint32_t kStreamBufferMs{500};
+    SampleBankOptions options;
+    if (args.size() > 2) {
+        std::string_view mode{args[2]};
+        if (mode == "adpcm") {
+            options.compressed = true;
+        } else {
+            options.residentMs = static_cast<uint32_t>(std::atoi(args[2]));
+        }
+    }
+
+    RenderEngine engine{std::move(device), format};
+    if (options.residentMs > 0 && !engine.enableStreaming(kStreamBufferMs)) {
+        std::cout << "Streaming failed!\r\n";
+        return -1;
+    }
+    KitWatcher watcher{engine, args[1], options};
+    if (!watcher.start() || !engine.start()) {
+        std::cout << "Starting failed!\r\n";
+        return -1;
+    }
+
+    std::string instrument;
+    while (std::getline(std::cin, instrument)) {
+        if (instrument == "?") {
+            auto load = engine.dspLoad();
+            std::cout << "DSP load: " << load.load << " % (peak " << load.peakLoad << " %), "
+                      << load.deadlineMisses << " of " << load.periods << " periods missed the "
+                      << load.deadlineUs << " us deadline\r\n";
+            const char* stages[] = {"triggers", "voices", "effects", "conversion", "driver write"};
+            for (size_t stage = 0; stage < DspLoadMeter::kStageCount; ++stage) {
+                std::cout << "  " << stages[stage] << ": " << load.averageUs[stage]
+                          << " us avg, " << load.worstUs[stage] << " us worst\r\n";
+            }
+            continue;
+        }
+        if (!engine.trigger(instrument, 127, 0, FrameClock::now())) {
+            std::cout << "Trigger queue full\r\n";
+        }
+    }
+    std::cout << "Stream underruns: " << engine.streamUnderruns()
+              << " open failures: " << engine.streamOpenFailures()
+              << " dropped periods: " << engine.droppedPeriods() << "\r\n";
+
+    return 0;
+}
@@ -0,0 +1,43 @@
+#include <chrono>
+#include <iostream>
+#include <span>
+#include <string>
+
+#include <poll.h>
+
+#include "rpi_sound/playlist.hpp"
+#include "rpi_sound/tiny_alsa_wrapper.hpp"
+
+// Plays the given files back to back on one open device, gapless or
+// crossfaded by the given number of milliseconds.
+// usage: play_list <card> <device> <crossfade ms> <file>...
+int main(int argc, char* argv[]) {
+
+    std::span<char*> args(argv, argc);
+    if (args.size() < 5) {
+        std::cout << "usage: play_list <card> <device> <crossfade ms> <file>...\r\n";
+        return -1;
+    }
+
+    Playlist playlist{std::make_unique<TinyAlsaWrapper>(true)};
+    auto format = TinyAlsaWrapper{}.getDefaultFormat();
+    if (!playlist.open(std::stoi(args[1]), std::stoi(args[2]), format)) {
+        return -1;
+    }
+    playlist.setCrossfade(std::chrono::milliseconds{std::stoi(args[3])});
+    for (auto* file : args.subspan(4)) {
+        playlist.append(file);
+    }
+
+    pollfd audio{.fd = playlist.pollFd(), .events = POLLOUT, .revents = 0};
+    do {
+        if (poll(&audio, 1, -1) < 0) {
+            std::cout << "poll failed!\r\n";
+            return -1;
+        }
+        playlist.onWritable();
+    } while (!playlist.isIdle());
+
+    std::cout << "Underruns: " << playlist.underruns() << "\r\n";
+    return 0;
+}
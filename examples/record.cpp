@@ -0,0 +1,58 @@
+#include <cstdlib>
+#include <iostream>
+#include <span>
+#include <string>
+
+#include "rpi_sound/recorder.hpp"
+#include "rpi_sound/tiny_alsa_wrapper.hpp"
+
+// Records a capture device to a WAV file until enter is pressed.
+// Usage: record <file> [card] [device] [rate] [channels] [bits]
+// e.g. record take.wav 1 0 96000 4 24
+namespace {
+    constexpr uint32_t kMaxChannels{32};
+}
+
+int main(int argc, char* argv[]) {
+
+    std::span<char*> args(argv, argc);
+    if (args.size() < 2) {
+        std::cout << "no output file provided.\r\n";
+        return -1;
+    }
+    auto argAt = [&args](size_t index, uint32_t fallback) {
+        return args.size() > index ? static_cast<uint32_t>(std::atoi(args[index])) : fallback;
+    };
+    const auto channels = argAt(5, 2);
+    const auto bits = argAt(6, 16);
+    if (channels < 1 || channels > kMaxChannels || (bits != 16 && bits != 24 && bits != 32)) {
+        std::cout << "Usage: record <file> [card] [device] [rate] [channels 1-" << kMaxChannels
+                  << "] [bits 16|24|32]\r\n";
+        return -1;
+    }
+
+    auto driver = std::make_unique<TinyAlsaWrapper>();
+    auto format = driver->getDefaultFormat();
+    format.periodCount = 8;
+    format.startTreshold = 1;
+    format.stopTreshold = format.periodSize * format.periodCount;
+    format.audioFormat = AudioFormat(argAt(4, 48000), static_cast<uint16_t>(channels), false,
+                                     static_cast<uint16_t>(bits));
+
+    Recorder recorder{std::move(driver)};
+    if (!recorder.start(argAt(2, 0), argAt(3, 0), format, args[1])) {
+        std::cout << "Recording failed!\r\n";
+        return -1;
+    }
+    std::cout << "Recording, press enter to stop.\r\n";
+    std::string line;
+    std::getline(std::cin, line);
+
+    auto isOk = recorder.stop();
+    auto stats = recorder.stats();
+    std::cout << "Frames: " << stats.writtenFrames
+              << " dropped: " << stats.droppedFrames
+              << " capture errors: " << stats.captureErrors
+              << " ring peak: " << stats.ringHighWater * 100 / stats.ringCapacity << "%\r\n";
+    return isOk ? 0 : -1;
+}
@@ -0,0 +1,157 @@
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdlib>
+#include <iostream>
+#include <span>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include "rpi_sound/render_engine.hpp"
+
+// Measures the render thread cost per period without an audio device.
+// The pitched runs retune every voice by a few semitones. The loops runs
+// compare the engine with the loops selected for the format against the
+// generic ones, rendering the same voices.
+// usage: render_bench [voices] [period_size] [worker_threads]
+namespace {
+    constexpr uint32_t kPeriods{2000};
+    constexpr uint32_t kSampleSeconds{4};
+    constexpr int16_t kPitchCents{-350};
+    constexpr uint32_t kRounds{6};
+
+    class NullDevice : public IAudioDeviceManager {
+    public:
+        std::vector<AudioDevice> listDevices() override {
+            return {};
+        }
+        bool setDevice(int32_t, int32_t, AudioDevice::Type) override {
+            return true;
+        }
+        bool writeData(const std::vector<uint8_t>&) override {
+            return true;
+        }
+        bool getTimestamp(uint32_t&, timespec&) override {
+            return false;
+        }
+    };
+
+    std::shared_ptr<const SampleBank> makeBank(const AudioFormat& format, bool compressed) {
+        auto pcm = std::make_shared<PCMData>();
+        pcm->format = format;
+        auto frames = format.sampleRate * kSampleSeconds;
+        pcm->data.resize(static_cast<size_t>(frames) * format.channels * sizeof(int16_t));
+        auto* samples = reinterpret_cast<int16_t*>(pcm->data.data());
+        uint32_t noise = 1;
+        for (size_t i = 0; i < static_cast<size_t>(frames) * format.channels; ++i) {
+            noise = noise * 1664525u + 1013904223u;
+            samples[i] = static_cast<int16_t>(noise >> 18);
+        }
+
+        Sample sample{"bench.wav", {}, nullptr, nullptr, frames, frames, 0};
+        if (compressed) {
+            sample.adpcm = AdpcmCodec::encode(*pcm);
+        } else {
+            sample.pcm = pcm;
+        }
+        Instrument instrument{"bench", SampleBank::instrumentId("bench"), {sample}};
+        return std::make_shared<const SampleBank>(format, std::vector<Instrument>{instrument});
+    }
+
+    struct Result {
+        double perPeriod;     // us
+        size_t residentBytes;
+    };
+
+    Result measure(const HWAudioFormat& format, uint32_t voices, uint32_t workers, bool compressed, int16_t pitch,
+                   Interpolation interpolation, bool isGeneric = false) {
+        RenderEngine engine{std::make_unique<NullDevice>(), format};
+        engine.setWorkerThreads(workers);
+        engine.setInterpolation(interpolation);
+        if (isGeneric) {
+            engine.useGenericLoops();
+        }
+        auto bank = makeBank(engine.sampleFormat(), compressed);
+        engine.publishBank(bank);
+
+        auto voiceFrames = format.audioFormat.sampleRate * kSampleSeconds / std::exp2(pitch / 1200.0);
+        auto periodsPerVoice = static_cast<uint32_t>(std::ceil(voiceFrames / format.periodSize));
+        auto elapsed = std::chrono::nanoseconds{0};
+        for (uint32_t period = 0; period < kPeriods; ++period) {
+            // keep the requested polyphony by retriggering as voices end
+            if (period % periodsPerVoice == 0) {
+                for (uint32_t voice = 0; voice < voices; ++voice) {
+                    engine.trigger("bench", 127, pitch);
+                }
+            }
+            auto start = std::chrono::steady_clock::now();
+            engine.renderPeriod();
+            elapsed += std::chrono::steady_clock::now() - start;
+        }
+        return Result{std::chrono::duration<double, std::micro>(elapsed).count() / kPeriods, bank->residentBytes()};
+    }
+
+    void run(std::string_view name, const HWAudioFormat& format, uint32_t voices, uint32_t workers, bool compressed,
+             int16_t pitch = 0, Interpolation interpolation = Interpolation::kCubic) {
+        auto result = measure(format, voices, workers, compressed, pitch, interpolation);
+        auto deadline = 1e6 * format.periodSize / format.audioFormat.sampleRate;
+        std::cout << name << ": " << result.perPeriod << " us/period, "
+                  << 1000.0 * result.perPeriod / (static_cast<double>(voices) * format.periodSize) << " ns/voice-frame, "
+                  << 100.0 * result.perPeriod / deadline << " % DSP load, "
+                  << result.residentBytes / 1024 << " KiB\r\n";
+    }
+
+    // Runs the loops selected for the format and the generic ones in turns,
+    // starting with a different one each round, and reports the median and
+    // the spread of each.
+    void compare(std::string_view name, const HWAudioFormat& format, uint32_t voices, uint32_t workers,
+                 int16_t pitch = 0) {
+        std::vector<double> selected;
+        std::vector<double> generic;
+        for (uint32_t round = 0; round < kRounds; ++round) {
+            for (auto isGeneric : {round % 2 == 0, round % 2 != 0}) {
+                auto result = measure(format, voices, workers, false, pitch, Interpolation::kCubic, isGeneric);
+                (isGeneric ? generic : selected).push_back(result.perPeriod);
+            }
+        }
+        std::sort(selected.begin(), selected.end());
+        std::sort(generic.begin(), generic.end());
+        auto median = [](const std::vector<double>& times) {
+            return times[times.size() / 2];
+        };
+        std::cout << name << ": selected " << median(selected) << " us/period (" << selected.front() << "-"
+                  << selected.back() << "), generic " << median(generic) << " us/period (" << generic.front() << "-"
+                  << generic.back() << "), " << 100.0 * (1.0 - median(selected) / median(generic)) << " % less\r\n";
+    }
+}
+
+int main(int argc, char* argv[]) {
+
+    std::span<char*> args(argv, argc);
+    uint32_t voices = args.size() > 1 ? static_cast<uint32_t>(std::atoi(args[1])) : 32;
+    uint32_t periodSize = args.size() > 2 ? static_cast<uint32_t>(std::atoi(args[2])) : 256;
+    uint32_t workers = args.size() > 3 ? static_cast<uint32_t>(std::atoi(args[3])) : 0;
+
+    HWAudioFormat format{};
+    format.periodSize = periodSize;
+    format.periodCount = 2;
+    format.audioFormat = AudioFormat{};
+
+    std::cout << voices << " voices, " << periodSize << " frames/period, " << workers << " worker threads\r\n";
+    run("pcm", format, voices, workers, false);
+    run("adpcm", format, voices, workers, true);
+    run("pcm linear", format, voices, workers, false, kPitchCents, Interpolation::kLinear);
+    run("pcm cubic", format, voices, workers, false, kPitchCents, Interpolation::kCubic);
+    run("pcm sinc", format, voices, workers, false, kPitchCents, Interpolation::kSinc);
+
+    for (auto audioFormat : {AudioFormat(44100, 2, false, 16), AudioFormat(44100, 2, true, 32)}) {
+        auto output = format;
+        output.audioFormat = audioFormat;
+        std::string suffix = audioFormat.isFloat ? " f32" : " s16";
+        compare("loops pcm" + suffix, output, voices, workers);
+        compare("loops pcm cubic" + suffix, output, voices, workers, kPitchCents);
+    }
+
+    return 0;
+}
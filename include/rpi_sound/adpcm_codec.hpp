@@ -0,0 +1,33 @@
+#ifndef _ADPCM_CODEC_HPP__
+#define _ADPCM_CODEC_HPP__
+
+#include <cstdint>
+#include <memory>
+#include <vector>
+
+#include "audio_utils.hpp"
+
+// 16-bit PCM stored as IMA ADPCM blocks (the WAVE_FORMAT_IMA_ADPCM layout).
+// Every block starts with the exact first frame and the step index of each
+// channel, so any block can be decoded on its own.
+struct AdpcmData {
+    AudioFormat format;         // of the decoded frames
+    uint32_t blockAlign;
+    uint32_t framesPerBlock;
+    uint32_t frameCount;
+    std::vector<uint8_t> blocks;
+};
+
+class AdpcmCodec {
+public:
+    static constexpr uint32_t kBlockBytesPerChannel = 512;
+    static constexpr uint16_t kMaxChannels = 8;
+
+    static uint32_t framesPerBlock(uint32_t blockAlign, uint16_t channels);
+    static std::shared_ptr<AdpcmData> encode(const PCMData& pcm);
+    static std::shared_ptr<PCMData> decode(const AdpcmData& adpcm);
+    // Writes framesPerBlock interleaved frames of the given block to out.
+    static void decodeBlock(const AdpcmData& adpcm, uint32_t block, int16_t* out);
+};
+
+#endif // _ADPCM_CODEC_HPP__
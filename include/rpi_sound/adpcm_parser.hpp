@@ -0,0 +1,24 @@
+#ifndef _ADPCM_PARSER_HPP__
+#define _ADPCM_PARSER_HPP__
+
+#include "adpcm_codec.hpp"
+#include "iaudio_parser.hpp"
+
+// Loads a 16-bit PCM WAV file and keeps it IMA ADPCM compressed, which
+// takes about a quarter of the memory. getPCMData() decodes on every call.
+class AdpcmParser : public IAudioParser {
+public:
+    AdpcmParser() = default;
+    ~AdpcmParser() override = default;
+
+    bool load(const std::string_view& filePath) override;
+    std::shared_ptr<PCMData> getPCMData() const override;
+    AudioFormat getAudioFormat() const override;
+
+    std::shared_ptr<const AdpcmData> getCompressedData() const;
+
+private:
+    std::shared_ptr<const AdpcmData> adpcm_data_;
+};
+
+#endif // _ADPCM_PARSER_HPP__
@@ -15,7 +15,8 @@ public:
 
     std::vector<AudioDevice> listDevices() override;
     bool setDevice(int32_t cardId, int32_t deviceId, AudioDevice::Type type) override;
-    void writeData(const std::vector<uint8_t>& data) override;
+    bool writeData(const std::vector<uint8_t>& data) override;
+    bool getTimestamp(uint32_t& available, timespec& time) override;
  
     // move is allowed
     AudioDeviceManager(AudioDeviceManager&&) = default;
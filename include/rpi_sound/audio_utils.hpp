@@ -6,7 +6,9 @@ extern "C" {
 }
 
 #include <cstdint>
+#include <string>
 #include <tuple>
+#include <vector>
 
 struct AudioFormat {
     uint32_t sampleRate;
@@ -110,6 +112,7 @@ struct AudioDevice {
         kCapture
     };
     int32_t card;
+    std::string id;             // e.g. "Headphones", stable across replugging
     std::vector<std::tuple<int32_t, Type, HWAudioFormat>> device;
     std::string driver;
     std::string description;
@@ -0,0 +1,28 @@
+#ifndef _DETACHED_TASK_HPP__
+#define _DETACHED_TASK_HPP__
+
+#include <coroutine>
+#include <exception>
+
+// Return type for fire-and-forget coroutines, e.g. one that awaits
+// Player::playAsync() from an event loop. The coroutine starts right away
+// and its frame is freed when the body returns.
+struct DetachedTask {
+    struct promise_type {
+        DetachedTask get_return_object() noexcept {
+            return {};
+        }
+        std::suspend_never initial_suspend() noexcept {
+            return {};
+        }
+        std::suspend_never final_suspend() noexcept {
+            return {};
+        }
+        void return_void() noexcept {}
+        void unhandled_exception() noexcept {
+            std::terminate();
+        }
+    };
+};
+
+#endif // _DETACHED_TASK_HPP__
@@ -0,0 +1,93 @@
+#ifndef _DISK_STREAMER_HPP__
+#define _DISK_STREAMER_HPP__
+
+#include <atomic>
+#include <cstdint>
+#include <memory>
+#include <thread>
+
+#include "sample_bank.hpp"
+#include "spsc_queue.hpp"
+
+// Streams the non-resident tail of samples into one ring buffer per stream.
+// The render thread opens a stream when a voice starts and reads from its
+// ring; a prefetch thread does all file I/O. Nothing is shared between the
+// two but the ring positions, so the render thread never blocks on the disk:
+// missing data is replaced by silence and counted as an underrun. Tails are
+// read from the sample's SampleFile, never reopened by path.
+class DiskStreamer {
+public:
+    DiskStreamer(const AudioFormat& format, uint32_t bufferFrames, uint32_t streamCount);
+    ~DiskStreamer();
+
+    bool start();
+    void stop();
+
+    // Render side. Different streams may be served by different threads,
+    // one stream only ever by one thread at a time.
+    bool open(uint32_t stream, const Sample& sample);
+    uint32_t read(uint32_t stream, uint8_t* data, uint32_t frames);
+    void drop(uint32_t stream, uint32_t frames);
+    void close(uint32_t stream);
+
+    uint64_t underruns() const {
+        return underruns_.load(std::memory_order_relaxed);
+    }
+    // Streams that could not be opened, either because the request queue
+    // was full or the sample has no file. Only their head plays.
+    uint64_t openFailures() const {
+        return open_failures_.load(std::memory_order_relaxed);
+    }
+
+    // copying is not allowed
+    DiskStreamer(const DiskStreamer&) = delete;
+    DiskStreamer& operator=(const DiskStreamer&) = delete;
+
+private:
+    static constexpr size_t kRequestQueueSize = 64;
+
+    struct Request {
+        uint32_t stream;
+        uint16_t serial;
+        uint64_t offset;
+        uint64_t size;
+        // released by the prefetch thread, so a file is never closed on the render thread
+        std::shared_ptr<const SampleFile> file;
+    };
+
+    struct Stream {
+        std::unique_ptr<uint8_t[]> ring;
+        // serial in the upper 16 bits, byte position in the lower 48
+        alignas(64) std::atomic<uint64_t> readState{0};
+        alignas(64) std::atomic<uint64_t> writeState{0};
+        // render thread
+        uint16_t serial{0};
+        uint64_t readPos{0};
+        // prefetch thread
+        std::shared_ptr<const SampleFile> file;
+        uint16_t ioSerial{0};
+        uint64_t writePos{0};
+        uint64_t fileOffset{0};
+        uint64_t remaining{0};
+    };
+
+    void run();
+    void openRequest(const Request& request);
+    bool fill(Stream& stream);
+    void closeFile(Stream& stream);
+    void wake();
+
+    uint32_t frame_size_;
+    uint64_t ring_size_;
+    uint32_t stream_count_;
+    std::unique_ptr<Stream[]> streams_;
+    SpscQueue<Request, kRequestQueueSize> requests_;
+    std::atomic<uint64_t> underruns_{0};
+    std::atomic<uint64_t> open_failures_{0};
+
+    int wake_fd_{-1};
+    std::thread thread_;
+    std::atomic<bool> running_{false};
+};
+
+#endif // _DISK_STREAMER_HPP__
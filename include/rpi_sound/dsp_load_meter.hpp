@@ -0,0 +1,73 @@
+#ifndef _DSP_LOAD_METER_HPP__
+#define _DSP_LOAD_METER_HPP__
+
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+
+#include "audio_utils.hpp"
+
+// Per-period timing of the render loop against the period deadline
+// (periodSize / sampleRate). The render thread marks the end of each stage;
+// the figures are published through a seqlock, so snapshot() can be called
+// from any thread without ever blocking the render thread.
+class DspLoadMeter {
+public:
+    enum Stage {
+        kTriggers,
+        kVoices,
+        kEffects,
+        kConversion,
+        kDriverWrite,   // blocking time of the device, not part of the DSP load
+        kStageCount
+    };
+
+    struct Snapshot {
+        uint64_t periods;
+        uint64_t deadlineMisses;
+        double deadlineUs;
+        double load;        // percent of the deadline, rolling average
+        double peakLoad;    // percent of the deadline, worst period
+        std::array<double, kStageCount> averageUs;
+        std::array<double, kStageCount> worstUs;
+    };
+
+    explicit DspLoadMeter(const HWAudioFormat& format);
+
+    // Render thread only. beginPeriod() publishes the previous period.
+    // mark() charges the time since the previous mark to stage, a stage
+    // marked more than once per period adds up.
+    void beginPeriod();
+    void mark(Stage stage);
+
+    Snapshot snapshot() const;
+
+private:
+    using Clock = std::chrono::steady_clock;
+
+    void publish();
+
+    double deadline_ns_;
+    bool is_pending_{false};
+    Clock::time_point last_mark_;
+    std::array<double, kStageCount> stage_ns_{};
+
+    // render thread state, copied out in publish()
+    uint64_t periods_{0};
+    uint64_t misses_{0};
+    double load_{0};
+    double peak_load_{0};
+    std::array<double, kStageCount> average_ns_{};
+    std::array<double, kStageCount> worst_ns_{};
+
+    std::atomic<uint32_t> sequence_{0};
+    std::atomic<uint64_t> published_periods_{0};
+    std::atomic<uint64_t> published_misses_{0};
+    std::atomic<double> published_load_{0};
+    std::atomic<double> published_peak_load_{0};
+    std::array<std::atomic<double>, kStageCount> published_average_ns_{};
+    std::array<std::atomic<double>, kStageCount> published_worst_ns_{};
+};
+
+#endif // _DSP_LOAD_METER_HPP__
@@ -0,0 +1,102 @@
+#ifndef _FAILOVER_DEVICE_HPP__
+#define _FAILOVER_DEVICE_HPP__
+
+#include <atomic>
+#include <chrono>
+#include <functional>
+#include <memory>
+#include <string>
+#include <thread>
+
+#include "iaudio_device_manager.hpp"
+#include "iaudio_driver.hpp"
+
+// Plays on a primary card and moves to a fallback card while the primary is
+// gone, e.g. a USB interface pulled on stage. Loss is noticed either by a
+// failed write or by the pcm node vanishing from /dev/snd (inotify), and the
+// fallback is opened in advance, so the period that failed already goes out
+// on the fallback. The watcher thread reopens the primary as soon as a card
+// with the same id shows up again, under whatever card number it gets, and
+// the render thread takes it back on its next write. A card that is still
+// there but fails to write (e.g. persistent EIO) is reopened after a delay
+// that doubles each time it fails again soon after, so output doesn't flap
+// between the two every period. Opening and closing never happen on the
+// render thread.
+class FailoverDevice : public IAudioDeviceManager {
+public:
+    using DriverFactory = std::function<std::unique_ptr<IAudioDriver>()>;
+
+    explicit FailoverDevice(DriverFactory factory,
+                            std::string devicePath = "/dev/snd",
+                            std::string procPath = "/proc/asound");
+    ~FailoverDevice() override;
+
+    std::vector<AudioDevice> listDevices() override;
+    // Opens the primary playback card and starts watching for it.
+    bool setDevice(int32_t cardId, int32_t deviceId, AudioDevice::Type type) override;
+    bool writeData(const std::vector<uint8_t>& data) override;
+    // Render thread, like writeData().
+    bool getTimestamp(uint32_t& available, timespec& time) override;
+
+    // Opens the fallback by card id (e.g. "Headphones") in the format of the
+    // primary. Call after setDevice() and before output starts. Nothing is
+    // converted on a switch, so the fallback has to support exactly that
+    // rate, channel count and sample format: the Pi headphone jack, for one,
+    // can't take over from a 6-channel or 96 kHz USB interface. Returns false
+    // with the format in the log if it can't, and output then stops while
+    // the primary is gone.
+    bool setFallback(const std::string& cardId, int32_t deviceId);
+
+    bool isOnFallback() const;
+    uint32_t failovers() const;
+
+    // copying is not allowed
+    FailoverDevice(const FailoverDevice&) = delete;
+    FailoverDevice& operator=(const FailoverDevice&) = delete;
+
+private:
+    enum State {
+        kPrimary,           // render thread owns the primary
+        kFallback,          // watcher thread owns the primary
+        kPrimaryReady       // reopened, handed back to the render thread
+    };
+
+    void run();
+    void wake();
+    void handleEvents(const char* buffer, size_t length);
+    bool reopenPrimary(int32_t card);
+    void scheduleRetry();
+    int retryTimeoutMs() const;
+    std::string readCardId(int32_t card) const;
+    int32_t findCard(const std::string& cardId) const;
+    HWAudioFormat formatOf(int32_t card, int32_t deviceId, IAudioDriver& driver) const;
+
+    DriverFactory factory_;
+    std::string device_path_;
+    std::string proc_path_;
+    std::vector<AudioDevice> devices_;
+
+    std::unique_ptr<IAudioDriver> primary_;
+    std::unique_ptr<IAudioDriver> fallback_;
+    std::string primary_id_;
+    int32_t primary_card_{-1};
+    int32_t primary_device_{0};
+    HWAudioFormat primary_format_{};
+
+    std::atomic<State> state_{kFallback};
+    std::atomic<bool> is_primary_gone_{false};
+    std::atomic<uint32_t> failovers_{0};
+
+    // watcher thread, reopening a card that failed but didn't go away
+    std::chrono::milliseconds retry_delay_{0};
+    std::chrono::steady_clock::time_point last_attempt_{};
+    std::chrono::steady_clock::time_point retry_at_{};
+    bool is_retry_pending_{false};
+
+    int inotify_fd_{-1};
+    int wake_fd_{-1};
+    std::thread thread_;
+    std::atomic<bool> running_{false};
+};
+
+#endif // _FAILOVER_DEVICE_HPP__
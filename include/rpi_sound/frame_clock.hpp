@@ -0,0 +1,55 @@
+#ifndef _FRAME_CLOCK_HPP__
+#define _FRAME_CLOCK_HPP__
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <ctime>
+
+// Maps CLOCK_MONOTONIC time to the frame the DAC plays at that time. The
+// render thread adds one (time, frame) pair per period, taken from the
+// device timestamp. A least-squares line through the last kSamples pairs
+// smooths out the jitter of the timestamps and follows the drift of the
+// sound card crystal against the system clock.
+class FrameClock {
+public:
+    static constexpr size_t kSamples = 32;
+    static constexpr size_t kMinSamples = 4;
+
+    explicit FrameClock(uint32_t sampleRate);
+
+    // CLOCK_MONOTONIC in nanoseconds.
+    static int64_t now();
+    static int64_t toNanoseconds(const timespec& time);
+
+    // A pair more than a few milliseconds off the line, e.g. after an xrun
+    // or a switch to another card, starts a new fit.
+    void addSample(int64_t time, int64_t frame);
+    void reset();
+
+    bool isLocked() const {
+        return count_ >= kMinSamples;
+    }
+    // Only meaningful once locked.
+    int64_t frameAt(int64_t time) const;
+
+private:
+    void fit();
+
+    double nominal_rate_;       // frames per nanosecond
+    int64_t max_error_frames_;
+
+    std::array<int64_t, kSamples> times_{};
+    std::array<int64_t, kSamples> frames_{};
+    size_t next_{0};
+    size_t count_{0};
+
+    // the line, relative to the newest pair to keep the doubles exact
+    int64_t base_time_{0};
+    int64_t base_frame_{0};
+    double mean_time_{0};
+    double mean_frame_{0};
+    double rate_{0};
+};
+
+#endif // _FRAME_CLOCK_HPP__
@@ -1,6 +1,7 @@
 #ifndef _IAUDIO_DEVICE_MANAGER_HPP__
 #define _IAUDIO_DEVICE_MANAGER_HPP__
 
+#include <ctime>
 #include <string>
 #include <vector>
 
@@ -10,7 +11,10 @@ class IAudioDeviceManager {
 public:
     virtual std::vector<AudioDevice> listDevices() = 0;
     virtual bool setDevice(int32_t cardId, int32_t deviceId, AudioDevice::Type type) = 0;
-    virtual void writeData(const std::vector<uint8_t>& data) = 0;
+    // Returns false if the data could not be written to the device.
+    virtual bool writeData(const std::vector<uint8_t>& data) = 0;
+    // See IAudioDriver::getTimestamp(), for the device the last write went to.
+    virtual bool getTimestamp(uint32_t& available, timespec& time) = 0;
     virtual ~IAudioDeviceManager() = default;
 };
 
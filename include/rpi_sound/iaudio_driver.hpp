@@ -1,6 +1,7 @@
 #ifndef _IAUDIO_DRIVER_HPP__
 #define _IAUDIO_DRIVER_HPP__
 
+#include <ctime>
 #include <string>
 #include <vector>
 
@@ -10,9 +11,24 @@ class IAudioDriver {
 public:
     virtual ~IAudioDriver() = default;
     virtual bool openDevice(uint32_t card, uint32_t device, bool isOutput, HWAudioFormat& config) = 0;
+    // Releases the device so it can be opened again. Does nothing if it isn't open.
+    virtual void closeDevice() = 0;
     virtual bool getDeviceFormat(uint32_t card, uint32_t device, bool isOutput, HWAudioFormat& config) = 0;
-    virtual void writeData(const std::vector<uint8_t>& data) = 0;
+    virtual bool writeData(const std::vector<uint8_t>& data) = 0;
+    // Returns the number of frames read, or a negative value on error.
+    virtual int32_t readData(uint8_t* data, uint32_t frames) = 0;
     virtual HWAudioFormat getDefaultFormat() = 0;
+
+    // Event loop integration: poll the fd for POLLOUT, then write without
+    // blocking. Returns the number of frames written, which is limited to
+    // what the device buffer can take, or a negative value on error.
+    virtual int getPollFd() const = 0;
+    virtual int32_t writeAvailable(const uint8_t* data, uint32_t frames) = 0;
+    // Frames written but not played yet, or a negative value on error.
+    virtual int32_t getQueuedFrames() = 0;
+    // Frames the device buffer can take and the CLOCK_MONOTONIC time the
+    // hardware pointer was read at, see pcm_get_htimestamp().
+    virtual bool getTimestamp(uint32_t& available, timespec& time) = 0;
 };
 
 #endif // _IAUDIO_DRIVER_HPP__
@@ -0,0 +1,57 @@
+#ifndef _INTERPOLATOR_HPP__
+#define _INTERPOLATOR_HPP__
+
+#include <cstddef>
+#include <cstdint>
+
+enum class Interpolation : uint8_t {
+    kLinear,    // 2 taps
+    kCubic,     // 4 taps, Catmull-Rom
+    kSinc       // 8 taps, Blackman windowed sinc, band-limited to the pitch
+};
+
+// Reads interleaved frames at a fractional rate. Positions are Q32.32
+// fixed-point frame indices, so a retuned voice never drifts no matter how
+// long it plays. The source is converted to float once, and the kernels
+// compute the coefficients of a block of output frames before applying
+// them, which keeps the inner loops free of branches so the compiler can
+// vectorize them. Mono and stereo get their own unrolled kernels. The
+// sinc cutoff goes down as the pitch goes up, so a voice pitched up loses
+// what would be above the output Nyquist instead of aliasing it.
+//
+// With RPI_SOUND_FIXED_POINT (the ENABLE_FIXED_POINT build option) the
+// window stays 16-bit and the kernels use Q14 coefficients, for boards
+// without a fast FPU like the Pi Zero.
+class Interpolator {
+public:
+#ifdef RPI_SOUND_FIXED_POINT
+    using Sample = int16_t;
+#else
+    using Sample = float;
+#endif
+
+    static constexpr uint64_t kUnity = uint64_t{1} << 32;
+    static constexpr uint32_t kMaxTaps = 8;
+    // Source frames needed before and after the integer part of a position.
+    static constexpr uint32_t kHistory = kMaxTaps / 2 - 1;
+    static constexpr uint32_t kLookahead = kMaxTaps / 2;
+
+    // Q32.32 position increment for a pitch offset in cents.
+    static uint64_t increment(int32_t cents);
+
+    static void toWindow(const int16_t* src, size_t samples, Sample* dst);
+
+    // Mixes frames output frames into dst, scaled by gain (Q15). position is
+    // relative to src, which must hold kHistory frames before the first and
+    // kLookahead frames after the last position read.
+    static void mix(Interpolation mode, const Sample* src, uint16_t channels, uint64_t position,
+                    uint64_t increment, uint32_t frames, int32_t gain, int32_t* dst);
+    // The same for a channel count known at compile time, for callers that
+    // are specialized on it themselves. Instantiated for 0 (read at
+    // runtime), 1, 2, 4, 6 and 8 channels.
+    template <uint16_t Channels>
+    static void mix(Interpolation mode, const Sample* src, uint16_t channels, uint64_t position,
+                    uint64_t increment, uint32_t frames, int32_t gain, int32_t* dst);
+};
+
+#endif // _INTERPOLATOR_HPP__
@@ -0,0 +1,44 @@
+#ifndef _KIT_WATCHER_HPP__
+#define _KIT_WATCHER_HPP__
+
+#include <atomic>
+#include <string>
+#include <thread>
+
+#include "render_engine.hpp"
+
+// Watches a kit directory with inotify and republishes the sample bank of
+// the engine whenever a sample is added, removed or rewritten. Loading and
+// conversion run on the watcher thread; unchanged samples are shared with
+// the previous bank instead of being loaded again.
+class KitWatcher {
+public:
+    KitWatcher(RenderEngine& engine, std::string kitPath, const SampleBankOptions& options = {}) :
+        engine_{engine},
+        kit_path_{std::move(kitPath)},
+        options_{options} {}
+    ~KitWatcher();
+
+    // Loads and publishes the kit once, then keeps watching it.
+    bool start();
+    void stop();
+
+    // copying is not allowed
+    KitWatcher(const KitWatcher&) = delete;
+    KitWatcher& operator=(const KitWatcher&) = delete;
+
+private:
+    void run();
+    bool reload();
+    void addWatches();
+
+    RenderEngine& engine_;
+    std::string kit_path_;
+    SampleBankOptions options_;
+    int inotify_fd_{-1};
+    int wake_fd_{-1};
+    std::thread thread_;
+    std::atomic<bool> running_{false};
+};
+
+#endif // _KIT_WATCHER_HPP__
@@ -1,23 +1,108 @@
 #ifndef _PLAYER_HPP__
 #define _PLAYER_HPP__
 
+#include <condition_variable>
+#include <coroutine>
+#include <deque>
 #include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
 #include "iaudio_device_manager.hpp"
+#include "iaudio_driver.hpp"
 #include "pcm_converter.hpp"
 
 class Player {
 public:
+    // Resumes the awaiting coroutine once the sound has been played out.
+    // co_await yields false if the file could not be loaded, or if the
+    // Player is destroyed before the sound is done.
+    class PlayAwaiter {
+    public:
+        bool await_ready() const noexcept {
+            return is_failed_;
+        }
+        void await_suspend(std::coroutine_handle<> waiter);
+        bool await_resume() const noexcept {
+            return is_played_;
+        }
+
+    private:
+        friend class Player;
+        PlayAwaiter(Player& player, std::string path, bool isFailed) :
+            player_{player},
+            path_{std::move(path)},
+            is_failed_{isFailed} {}
+
+        Player& player_;
+        std::string path_;
+        bool is_failed_;
+        bool is_played_{false};
+    };
+
     Player() :
         converter_{std::make_unique<PCMConverter>()} {}
+    explicit Player(std::unique_ptr<IAudioDriver> driver) :
+        converter_{std::make_unique<PCMConverter>()},
+        driver_{std::move(driver)} {}
+    ~Player();
 
     bool play(const std::string_view& filePath);
     bool stop();
     void initPCM();
 
+    // Non-blocking playback from the caller's event loop: add pollFd() to
+    // poll/epoll for POLLOUT and call onWritable() whenever it fires. The
+    // device keeps running on silence in between, so onWritable() is due
+    // about once per period. Sounds awaited at the same time play one
+    // after another. Files are read on a loader thread, the loop only
+    // picks them up in onWritable(), so a slow disk delays the sound but
+    // never the loop.
+    bool open(uint32_t card, uint32_t device, HWAudioFormat format);
+    int pollFd() const;
+    void onWritable();
+    [[nodiscard]] PlayAwaiter playAsync(const std::string_view& filePath);
+    // Some awaited file hasn't been read yet.
+    bool isLoading();
+
 private:
+    struct Pending {
+        std::shared_ptr<PCMData> sound;
+        std::coroutine_handle<> waiter;
+        PlayAwaiter* awaiter;
+        bool isLoaded;
+        uint64_t endFrame;      // device frame after the last one of the sound
+    };
+
+    struct LoadRequest {
+        std::string path;
+        AudioFormat format;
+    };
+
+    void writeSilence();
+    void collectLoads();
+    void load();
+
     std::unique_ptr<IAudioDeviceManager> audio_device_;
     std::unique_ptr<PCMConverter> converter_;
     AudioFormat hw_audio_format_;
+
+    std::unique_ptr<IAudioDriver> driver_;
+    uint32_t frame_bytes_{0};
+    std::vector<uint8_t> silence_;
+    std::deque<Pending> queued_;
+    std::deque<Pending> playing_;   // fully written, waiting to be played out
+    size_t position_{0};            // bytes written of queued_.front()
+    uint64_t written_frames_{0};
+    size_t loading_{0};             // entries of queued_ without a result yet
+
+    // shared with the loader, a failed load is a nullptr
+    std::mutex load_mutex_;
+    std::condition_variable load_wake_;
+    std::deque<LoadRequest> load_requests_;
+    std::deque<std::shared_ptr<PCMData>> loaded_;
+    bool is_loader_running_{false};
+    std::thread loader_;
 };
 
 #endif // _PCM_PLAYER_HPP__
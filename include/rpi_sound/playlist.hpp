@@ -0,0 +1,126 @@
+#ifndef _PLAYLIST_HPP__
+#define _PLAYLIST_HPP__
+
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <string_view>
+#include <thread>
+#include <vector>
+
+#include "iaudio_driver.hpp"
+
+// Plays queued files back to back on one open device. A loader thread
+// parses and converts the next files while the current one plays, so the
+// caller's loop only ever copies PCM that is already in memory. Tracks
+// follow each other sample-exact, or overlap by the crossfade time with
+// equal-power gains. The device runs on silence when the queue is empty.
+//
+// Tracks are decoded into memory in full: up to kPrefetchTracks waiting,
+// plus the current and, while crossfading, the next one. Four tracks of
+// 5 minutes at 48 kHz 16-bit stereo take about 230 MB, so keep long files
+// off memory-constrained boards or convert them to a smaller format.
+//
+// Driven like Player's non-blocking mode: poll pollFd() for POLLOUT and
+// call onWritable() whenever it fires. All methods but the loader belong
+// to that one thread.
+class Playlist {
+public:
+    Playlist();
+    explicit Playlist(std::unique_ptr<IAudioDriver> driver);
+    ~Playlist();
+
+    // Closes the device first if it is already open, dropping the queue.
+    bool open(uint32_t card, uint32_t device, HWAudioFormat format);
+    // Drops everything queued and the rest of the period in progress, the
+    // device plays on with silence. append() starts over without open().
+    void stop();
+
+    // Queues a file behind the ones already added. Files that can't be
+    // loaded in the device format are skipped.
+    bool append(const std::string_view& filePath);
+    // 0 (the default) plays the tracks gapless. Crossfading needs 16 or
+    // 32-bit integer or 32-bit float samples, other formats stay gapless.
+    // Applies to transitions that haven't started yet.
+    void setCrossfade(std::chrono::milliseconds time);
+
+    // Tracks loaded and waiting, e.g. to start only once the first one is.
+    size_t prefetched();
+
+    int pollFd() const;
+    void onWritable();
+
+    // Nothing queued or loading, and the last track has been played out.
+    bool isIdle() const {
+        return is_idle_;
+    }
+    // Times a track ended before the next one was loaded, counted when that
+    // one starts late. Files that fail to load don't count.
+    uint64_t underruns() const {
+        return underruns_;
+    }
+
+    // copying is not allowed
+    Playlist(const Playlist&) = delete;
+    Playlist& operator=(const Playlist&) = delete;
+
+private:
+    static constexpr size_t kPrefetchTracks = 2;
+
+    struct Track {
+        std::shared_ptr<PCMData> sound;
+        uint32_t frames{0};
+        uint32_t position{0};
+        uint64_t sequence{0};       // order of the append() call
+    };
+
+    struct Queued {
+        std::string path;
+        uint64_t sequence{0};
+    };
+
+    void stopLoader();
+    bool hasQueued();
+    void load();
+    bool takeTrack(Track& track);
+    void render(uint8_t* out, uint32_t frames);
+    void retire(Track& track);
+    void updateFade();
+
+    std::unique_ptr<IAudioDriver> driver_;
+    AudioFormat format_;
+    uint32_t frame_bytes_{0};
+    std::chrono::milliseconds crossfade_{0};
+    uint32_t fade_frames_{0};
+
+    // shared with the loader
+    std::mutex mutex_;
+    std::condition_variable wake_;
+    std::deque<Queued> paths_;
+    std::deque<Track> ready_;
+    std::vector<std::shared_ptr<PCMData>> retired_;    // freed by the loader
+    uint64_t dropped_before_{0};                       // sequences stop() dropped
+    bool is_loading_{false};
+    bool is_running_{false};
+    std::thread loader_;
+
+    // playback
+    uint64_t appended_{0};
+    Track current_;
+    Track next_;
+    uint32_t fade_start_{0};        // frame of current_ where next_ fades in
+    std::vector<uint8_t> period_;
+    size_t period_position_{0};
+    uint64_t rendered_frames_{0};
+    uint64_t written_frames_{0};
+    uint64_t end_frame_{0};         // rendered frame after the last track
+    uint64_t starved_before_{0};    // sequences queued when playback ran dry
+    bool is_idle_{true};
+    uint64_t underruns_{0};
+};
+
+#endif // _PLAYLIST_HPP__
@@ -0,0 +1,76 @@
+#ifndef _RECORDER_HPP__
+#define _RECORDER_HPP__
+
+#include <atomic>
+#include <memory>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "iaudio_driver.hpp"
+#include "spsc_ring.hpp"
+#include "wav_writer.hpp"
+
+struct RecorderOptions {
+    size_t ringBytes{32 << 20};         // ~28 s of 4 channels 24-bit/96 kHz
+    WavWriterOptions file{.directIo = true, .preallocateBytes = 256 << 20};
+};
+
+// Records a capture device to a WAV file. A capture thread reads periods
+// straight into a large lock-free ring and a writer thread flushes it to the
+// file, so a slow SD card only fills the ring instead of overrunning the
+// device. 24-bit input (S24_LE) is packed to 3 bytes per sample.
+class Recorder {
+public:
+    struct Stats {
+        uint64_t capturedFrames;
+        uint64_t writtenFrames;
+        uint64_t droppedFrames;     // captured while the ring was full
+        uint64_t captureErrors;
+        size_t ringHighWater;       // bytes
+        size_t ringCapacity;        // bytes
+    };
+
+    explicit Recorder(std::unique_ptr<IAudioDriver> driver) :
+        driver_{std::move(driver)} {}
+    ~Recorder();
+
+    bool start(uint32_t card, uint32_t device, HWAudioFormat format, const std::string& path,
+               const RecorderOptions& options = {});
+    // Closes the capture device, writes out everything captured so far and
+    // finalizes the file.
+    bool stop();
+    Stats stats() const;
+
+    // copying is not allowed
+    Recorder(const Recorder&) = delete;
+    Recorder& operator=(const Recorder&) = delete;
+
+private:
+    void captureLoop();
+    void writeLoop();
+    void writeChunk(const uint8_t* data, size_t bytes);
+
+    std::unique_ptr<IAudioDriver> driver_;
+    HWAudioFormat format_;
+    uint32_t capture_frame_bytes_{0};
+    bool is_packed_24_{false};
+    std::unique_ptr<SpscRing> ring_;
+    WavWriter writer_;
+    std::vector<uint8_t> drop_buffer_;
+    std::vector<uint8_t> pack_buffer_;
+
+    std::atomic<uint64_t> captured_frames_{0};
+    std::atomic<uint64_t> written_frames_{0};
+    std::atomic<uint64_t> dropped_frames_{0};
+    std::atomic<uint64_t> capture_errors_{0};
+    std::atomic<size_t> ring_high_water_{0};
+    bool is_write_failed_{false};
+
+    std::thread capture_thread_;
+    std::thread writer_thread_;
+    std::atomic<bool> running_{false};
+    std::atomic<bool> is_capture_done_{false};
+};
+
+#endif // _RECORDER_HPP__
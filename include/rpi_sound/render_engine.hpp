@@ -0,0 +1,239 @@
+#ifndef _RENDER_ENGINE_HPP__
+#define _RENDER_ENGINE_HPP__
+
+#include <array>
+#include <atomic>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <string_view>
+#include <thread>
+#include <vector>
+
+#include "disk_streamer.hpp"
+#include "dsp_load_meter.hpp"
+#include "frame_clock.hpp"
+#include "iaudio_device_manager.hpp"
+#include "interpolator.hpp"
+#include "sample_bank.hpp"
+#include "spsc_queue.hpp"
+#include "worker_pool.hpp"
+
+struct Trigger {
+    uint32_t instrument;    // SampleBank::instrumentId()
+    uint8_t velocity;       // 1..127
+    int16_t pitch{0};       // cents, on top of the instrument tuning
+    int64_t time{0};        // FrameClock::now() when it happened, 0 plays on the next period
+};
+
+// Polyphonic sample player. One render thread mixes the active voices into
+// periods of HWAudioFormat::periodSize frames and writes them to the device.
+// The active voices are split into groups, each mixed into its own buffer,
+// optionally on a pool of worker threads. The buffers are then summed in
+// group order, so the output does not depend on which thread rendered what.
+// Both loops are instantiated per channel count and output sample type, and
+// the pair for the format is picked once, when the engine is created.
+//
+// Timestamped triggers are placed on the DAC frame clock: a voice starts
+// triggerLatency() frames after its trigger happened, at any frame inside a
+// period, so fast patterns do not jitter by up to a period.
+//
+// Sample banks are swapped RCU-style: publishBank() only stores an atomic
+// pointer, and a replaced bank is kept alive until the render thread reports
+// that neither the live pointer nor any voice refers to it any more. The
+// render thread never locks, allocates or frees while doing so.
+class RenderEngine {
+public:
+    static constexpr uint32_t kMaxVoices = 64;
+    static constexpr size_t kTriggerQueueSize = 256;
+    // Pitch range of a voice, two octaves up or down.
+    static constexpr int32_t kMaxPitchCents = 2400;
+    static constexpr uint32_t kVoicesPerGroup = 4;
+
+    RenderEngine(std::unique_ptr<IAudioDeviceManager> device, const HWAudioFormat& format);
+    ~RenderEngine();
+
+    bool start();
+    void stop();
+    const HWAudioFormat& format() const {
+        return format_;
+    }
+    // Sample banks are 16-bit at the output rate and channel count; the
+    // output itself may be 16 or 32-bit integer or 32-bit float.
+    AudioFormat sampleFormat() const {
+        return AudioFormat(format_.audioFormat.sampleRate, format_.audioFormat.channels, false, 16);
+    }
+
+    // Streams the tails of partially resident samples (SampleBank::load
+    // with residentMs) through per-voice buffers of bufferMs. Call before start().
+    bool enableStreaming(uint32_t bufferMs);
+    uint64_t streamUnderruns() const;
+    uint64_t streamOpenFailures() const;
+
+    // Renders with up to threads worker threads next to the render thread,
+    // at most one per core the render thread doesn't use. With workers, the
+    // render thread is pinned to renderCore and the workers to the cores
+    // after it. The last core is the default because core 0 takes most
+    // interrupts on the Pi (USB, SD card, network). kUnpinned leaves the
+    // render thread and the workers to the scheduler, none of them is
+    // pinned. Call before start(), 0 threads render on the render thread
+    // only.
+    static constexpr int32_t kLastCore = -1;
+    static constexpr int32_t kUnpinned = -2;
+    bool setWorkerThreads(uint32_t threads, int32_t renderCore = kLastCore);
+
+    // Lock-free, any thread.
+    DspLoadMeter::Snapshot dspLoad() const {
+        return load_meter_.snapshot();
+    }
+    // Used by voices that are not at their original pitch, cubic by default.
+    void setInterpolation(Interpolation mode) {
+        interpolation_.store(mode, std::memory_order_relaxed);
+    }
+    // Renders with the loops that read the channel count and output format
+    // at runtime, the reference for render_bench and the tests. Call before
+    // start().
+    void useGenericLoops();
+
+    // Control side, any thread.
+    bool publishBank(std::shared_ptr<const SampleBank> bank);
+    std::shared_ptr<const SampleBank> bank() const;
+    // Frees retired banks no voice refers to, returns how many are still pending.
+    size_t collectRetired();
+
+    // Producer side of the trigger queue, one thread only. time is
+    // FrameClock::now() when the event happened, 0 plays on the next period.
+    bool trigger(std::string_view instrument, uint8_t velocity, int16_t pitch = 0, int64_t time = 0);
+    bool trigger(uint32_t instrumentId, uint8_t velocity, int16_t pitch = 0, int64_t time = 0);
+
+    // Constant delay of timestamped triggers: the device buffer plus the
+    // period a trigger waits for at most.
+    uint32_t triggerLatency() const {
+        return trigger_latency_;
+    }
+    // Timestamped triggers that came too late for their frame and were started early.
+    uint64_t lateTriggers() const {
+        return late_triggers_.load(std::memory_order_relaxed);
+    }
+    // Periods the device did not take, rendered at the period rate meanwhile.
+    uint64_t droppedPeriods() const {
+        return dropped_periods_.load(std::memory_order_relaxed);
+    }
+
+    // Render side, called by the render thread or by the owner when not started.
+    const std::vector<uint8_t>& renderPeriod();
+
+    // copying and moving is not allowed
+    RenderEngine(const RenderEngine&) = delete;
+    RenderEngine& operator=(const RenderEngine&) = delete;
+
+private:
+    struct BankSlot {
+        uint64_t generation;
+        std::shared_ptr<const SampleBank> bank;
+    };
+
+    static constexpr uint32_t kMaxVoiceGroups = kMaxVoices / kVoicesPerGroup;
+    static constexpr uint32_t kSumChunks = 4;
+
+    // one per participant of the worker pool
+    struct Scratch {
+        std::vector<uint8_t> stream;
+        std::vector<int16_t> pitchFetch;
+        std::vector<Interpolator::Sample> pitchWindow;
+    };
+
+    // renderGroup() and sumGroups() of one format
+    using LoopFn = void (RenderEngine::*)(uint32_t index, uint32_t worker);
+
+    struct PendingTrigger {
+        Trigger trigger;
+        int64_t frame;
+    };
+
+    struct Voice {
+        const int16_t* data;
+        const AdpcmData* adpcm;
+        uint32_t decodedBlock;  // block held in the decode cache of this voice
+        uint32_t frameCount;
+        uint32_t residentFrames;
+        uint32_t position;      // next source frame to read
+        uint32_t delay;         // frames of silence before the voice starts
+        uint64_t phase;         // Q32.32 playback position of pitched voices
+        uint64_t increment;     // Q32.32, Interpolator::kUnity plays at the original pitch
+        int32_t gain;           // Q15
+        uint64_t generation;
+        bool active;
+        bool streamed;
+    };
+
+    void run();
+    void updateClock();
+    int64_t scheduledFrame(const Trigger& trigger);
+    void startVoice(const Trigger& trigger, const BankSlot& slot, uint32_t delay);
+    void selectLoops();
+    template <uint16_t Channels>
+    void selectSum();
+    template <uint16_t Channels>
+    void renderGroup(uint32_t group, uint32_t worker);
+    template <uint16_t Channels>
+    void renderVoice(uint32_t index, Voice& voice, uint32_t frames, Scratch& scratch, int32_t* dst);
+    template <uint16_t Channels>
+    void renderCompressed(uint32_t index, Voice& voice, uint32_t frames, int32_t* dst);
+    template <uint16_t Channels>
+    void renderPitched(uint32_t index, Voice& voice, uint32_t frames, Scratch& scratch, int32_t* dst);
+    template <uint16_t Channels>
+    void fetchFrames(uint32_t index, Voice& voice, uint32_t frames, int16_t* dst);
+    // a void Sample sums with RenderPipeline::sumGeneric()
+    template <typename Sample, uint16_t Channels>
+    void sumGroups(uint32_t chunk, uint32_t worker);
+    template <uint16_t Channels>
+    uint16_t channels() const {
+        return Channels ? Channels : format_.audioFormat.channels;
+    }
+    Scratch makeScratch() const;
+    uint32_t nextRandom();
+
+    std::unique_ptr<IAudioDeviceManager> device_;
+    HWAudioFormat format_;
+    LoopFn render_group_{nullptr};
+    LoopFn sum_groups_{nullptr};        // nullptr for output formats the engine can't render
+    DspLoadMeter load_meter_;
+
+    SpscQueue<Trigger, kTriggerQueueSize> triggers_;
+    std::array<PendingTrigger, kTriggerQueueSize> pending_{};
+    size_t pending_count_{0};
+    FrameClock frame_clock_;
+    uint64_t render_position_{0};          // frames rendered so far
+    uint32_t trigger_latency_;
+    std::atomic<uint64_t> late_triggers_{0};
+    std::atomic<uint64_t> dropped_periods_{0};
+    std::array<Voice, kMaxVoices> voices_{};
+    std::vector<uint8_t> period_;
+    std::vector<int32_t> group_mix_;       // kMaxVoiceGroups buffers of one period
+    std::array<uint8_t, kMaxVoices> active_voices_{};
+    uint32_t active_count_{0};
+    uint32_t group_count_{0};
+    std::unique_ptr<WorkerPool> workers_;
+    int32_t render_core_{kUnpinned};
+    std::vector<Scratch> scratch_;
+    uint32_t decode_cache_frames_;
+    std::vector<int16_t> decode_cache_;
+    std::vector<Interpolator::Sample> pitch_history_;  // last Interpolator::kMaxTaps source frames per voice
+    std::atomic<Interpolation> interpolation_{Interpolation::kCubic};
+    Interpolation period_interpolation_{Interpolation::kCubic};
+    std::unique_ptr<DiskStreamer> streamer_;
+    uint32_t random_state_{0x9e3779b9u};
+
+    std::atomic<const BankSlot*> live_bank_{nullptr};
+    std::atomic<uint64_t> oldest_generation_in_use_{0};
+    mutable std::mutex bank_mutex_;
+    uint64_t next_generation_{1};
+    std::unique_ptr<BankSlot> current_bank_;
+    std::vector<std::unique_ptr<BankSlot>> retired_banks_;
+
+    std::thread thread_;
+    std::atomic<bool> running_{false};
+};
+
+#endif // _RENDER_ENGINE_HPP__
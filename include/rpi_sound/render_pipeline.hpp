@@ -0,0 +1,86 @@
+#ifndef _RENDER_PIPELINE_HPP__
+#define _RENDER_PIPELINE_HPP__
+
+#include <algorithm>
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <limits>
+#include <type_traits>
+
+#include "audio_utils.hpp"
+
+// The per-sample loops of the render engine: mixing 16-bit voices into the
+// 32-bit mix, and summing the mix buffers into the device format (int16,
+// int32 as Q31, or float). They are templates on the channel count and the
+// output sample type, so RenderEngine instantiates its whole voice and sum
+// loops per format and these get inlined into them, with the channel count
+// a constant. Channels of 0 reads the channel count at runtime. sumGeneric()
+// checks the format per sample; with mix<0> it is the reference the
+// specialized loops are compared with in render_bench and the tests.
+struct RenderPipeline {
+    enum class Output {
+        kInt16,
+        kInt32,
+        kFloat,
+        kUnsupported
+    };
+
+    static Output outputOf(const AudioFormat& format);
+
+    // dst += src * gain (Q15), for frames interleaved frames
+    template <uint16_t Channels>
+    static void mix(const int16_t* src, uint16_t channels, uint32_t frames, int32_t gain, int32_t* dst) {
+        if constexpr (Channels != 0) {
+            channels = Channels;
+        }
+        const auto samples = static_cast<size_t>(frames) * channels;
+        for (size_t i = 0; i < samples; ++i) {
+            dst[i] += (static_cast<int32_t>(src[i]) * gain) >> 15;
+        }
+    }
+
+    // Sums samples [begin, end) of count buffers that are stride samples
+    // apart, in buffer order, and writes them to out as Sample.
+    template <typename Sample>
+    static void sum(const int32_t* buffers, size_t stride, uint32_t count, size_t begin, size_t end, uint8_t* out) {
+        // Blockwise, so every loop runs over contiguous samples.
+        auto* dst = reinterpret_cast<Sample*>(out);
+        std::array<int32_t, kSumBlock> sum;
+        for (auto start = begin; start < end; start += kSumBlock) {
+            auto samples = std::min(kSumBlock, end - start);
+            std::fill_n(sum.begin(), samples, 0);
+            for (uint32_t buffer = 0; buffer < count; ++buffer) {
+                const auto* src = buffers + buffer * stride + start;
+                for (size_t i = 0; i < samples; ++i) {
+                    sum[i] += src[i];
+                }
+            }
+            for (size_t i = 0; i < samples; ++i) {
+                dst[start + i] = toOutput<Sample>(sum[i]);
+            }
+        }
+    }
+
+    static void sumGeneric(const AudioFormat& format, const int32_t* buffers, size_t stride, uint32_t count,
+                           size_t begin, size_t end, uint8_t* out);
+
+    template <typename Sample>
+    static Sample toOutput(int32_t value) {
+        value = std::clamp(value, kMin, kMax);
+        if constexpr (std::is_same_v<Sample, float>) {
+            return static_cast<float>(value) * (1.0f / 32768.0f);
+        } else if constexpr (std::is_same_v<Sample, int32_t>) {
+            return static_cast<int32_t>(static_cast<uint32_t>(value) << 16);
+        } else {
+            return static_cast<int16_t>(value);
+        }
+    }
+
+private:
+    static constexpr size_t kSumBlock = 64;
+    static constexpr int32_t kMin = std::numeric_limits<int16_t>::min();
+    static constexpr int32_t kMax = std::numeric_limits<int16_t>::max();
+};
+
+#endif // _RENDER_PIPELINE_HPP__
@@ -0,0 +1,103 @@
+#ifndef _SAMPLE_BANK_HPP__
+#define _SAMPLE_BANK_HPP__
+
+#include <cstdint>
+#include <filesystem>
+#include <memory>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include "adpcm_codec.hpp"
+#include "audio_utils.hpp"
+
+struct SampleBankOptions {
+    uint32_t residentMs{0};     // keep only the head of each sample in RAM, stream the rest
+    bool compressed{false};     // keep samples IMA ADPCM compressed in RAM
+};
+
+// File a streamed tail is read from, open for as long as a bank holds it.
+// A voice of a retired bank keeps reading the file it was loaded from, even
+// after the kit has been reloaded because the file was replaced.
+class SampleFile {
+public:
+    explicit SampleFile(int fd) :
+        fd_{fd} {}
+    ~SampleFile();
+
+    int fd() const {
+        return fd_;
+    }
+
+    // copying is not allowed
+    SampleFile(const SampleFile&) = delete;
+    SampleFile& operator=(const SampleFile&) = delete;
+
+private:
+    int fd_;
+};
+
+struct Sample {
+    std::string path;
+    std::filesystem::file_time_type modified;
+    std::shared_ptr<const PCMData> pcm{};     // already converted to the bank format
+    std::shared_ptr<const AdpcmData> adpcm{}; // set instead of pcm for compressed banks
+    uint32_t frameCount{0};
+    uint32_t residentFrames{0};               // frames held in pcm, the rest is streamed
+    uint64_t dataOffset{0};                   // file offset of the first frame
+    std::shared_ptr<const SampleFile> file{}; // set when the tail is streamed
+};
+
+struct Instrument {
+    std::string name;
+    uint32_t id;                            // SampleBank::instrumentId(name)
+    std::vector<Sample> samples;
+    int32_t tuning{0};                      // cents, from <instrument>/tuning.txt
+};
+
+// Immutable set of instruments loaded from a kit directory laid out as
+// <kit>/<instrument>/<instrument>_N.wav. A bank is never modified after it
+// has been built; reloading builds a new bank which shares the PCM data of
+// every unchanged file with the previous one. An optional tuning.txt in an
+// instrument directory holds its pitch offset in cents, e.g. -200.
+class SampleBank {
+public:
+    SampleBank(const AudioFormat& format, std::vector<Instrument> instruments) :
+        format_{format},
+        instruments_{std::move(instruments)} {}
+
+    // Streamed and compressed samples are stored as they are in the file,
+    // so only files that already match the bank format are used for them.
+    static std::shared_ptr<const SampleBank> load(const std::string_view& kitPath,
+                                                  const AudioFormat& format,
+                                                  const SampleBank* previous = nullptr,
+                                                  const SampleBankOptions& options = {});
+
+    // FNV-1a, so triggers can address instruments without strings and stay
+    // valid across reloads that add or remove other instruments.
+    static constexpr uint32_t instrumentId(std::string_view name) {
+        uint32_t hash = 2166136261u;
+        for (auto c : name) {
+            hash = (hash ^ static_cast<uint8_t>(c)) * 16777619u;
+        }
+        return hash;
+    }
+
+    const Instrument* findInstrument(uint32_t id) const;
+    const std::vector<Instrument>& instruments() const {
+        return instruments_;
+    }
+    const AudioFormat& format() const {
+        return format_;
+    }
+    // Sample data held in RAM, in bytes.
+    size_t residentBytes() const;
+
+private:
+    const Sample* findSample(const std::string& path) const;
+
+    AudioFormat format_;
+    std::vector<Instrument> instruments_;
+};
+
+#endif // _SAMPLE_BANK_HPP__
@@ -0,0 +1,59 @@
+#ifndef _SPSC_RING_HPP__
+#define _SPSC_RING_HPP__
+
+#include <algorithm>
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <span>
+
+// Lock-free byte ring for one producer and one consumer thread. Both sides
+// get contiguous spans into the buffer, so a device can read straight into
+// it and a writer can flush straight out of it.
+class SpscRing {
+public:
+    explicit SpscRing(size_t capacity) :
+        buffer_{std::make_unique<uint8_t[]>(capacity)},
+        capacity_{capacity} {}
+
+    size_t capacity() const {
+        return capacity_;
+    }
+
+    size_t size() const {
+        return head_.load(std::memory_order_acquire) - tail_.load(std::memory_order_acquire);
+    }
+
+    // Producer side
+    std::span<uint8_t> writable() {
+        auto head = head_.load(std::memory_order_relaxed);
+        auto free = capacity_ - (head - tail_.load(std::memory_order_acquire));
+        auto offset = head % capacity_;
+        return {buffer_.get() + offset, std::min<size_t>(free, capacity_ - offset)};
+    }
+
+    void commitWrite(size_t bytes) {
+        head_.store(head_.load(std::memory_order_relaxed) + bytes, std::memory_order_release);
+    }
+
+    // Consumer side
+    std::span<const uint8_t> readable() {
+        auto tail = tail_.load(std::memory_order_relaxed);
+        auto used = head_.load(std::memory_order_acquire) - tail;
+        auto offset = tail % capacity_;
+        return {buffer_.get() + offset, std::min<size_t>(used, capacity_ - offset)};
+    }
+
+    void commitRead(size_t bytes) {
+        tail_.store(tail_.load(std::memory_order_relaxed) + bytes, std::memory_order_release);
+    }
+
+private:
+    std::unique_ptr<uint8_t[]> buffer_;
+    size_t capacity_;
+    alignas(64) std::atomic<uint64_t> head_{0};
+    alignas(64) std::atomic<uint64_t> tail_{0};
+};
+
+#endif // _SPSC_RING_HPP__
@@ -36,12 +36,12 @@ public:
         return *this;
     }
 
-    bool initialize(uint32_t card, uint32_t device, bool isOutput, HWAudioFormat& config) {
+    bool initialize(uint32_t card, uint32_t device, bool isOutput, HWAudioFormat& config, bool isNonBlocking = false) {
         if (!pcm_) {
             pcm_config pcmConfig = config.toPcmConfig();
             pcm_ = pcm_open(card,
                 device,
-                isOutput ? PCM_OUT : PCM_IN,
+                (isOutput ? PCM_OUT : PCM_IN) | PCM_MONOTONIC | (isNonBlocking ? PCM_NONBLOCK : 0),
                 &pcmConfig);
             if (!pcm_is_ready(pcm_)) {
                 std::cout << "PCM open failed!\r\n";
@@ -67,13 +67,24 @@ private:
 
 class TinyAlsaWrapper : public IAudioDriver {
 public:
+    // In non-blocking mode the PCM is opened with PCM_NONBLOCK and is meant
+    // to be fed through getPollFd() and writeAvailable().
+    explicit TinyAlsaWrapper(bool isNonBlocking = false) :
+        is_non_blocking_{isNonBlocking} {}
     ~TinyAlsaWrapper() override = default;
     bool openDevice(uint32_t card, uint32_t device, bool isOutput, HWAudioFormat& config) override;
+    void closeDevice() override;
     bool getDeviceFormat(uint32_t card, uint32_t device, bool isOutput, HWAudioFormat& config) override;
-    void writeData(const std::vector<uint8_t>& data) override;
+    bool writeData(const std::vector<uint8_t>& data) override;
+    int32_t readData(uint8_t* data, uint32_t frames) override;
     HWAudioFormat getDefaultFormat() override;
+    int getPollFd() const override;
+    int32_t writeAvailable(const uint8_t* data, uint32_t frames) override;
+    int32_t getQueuedFrames() override;
+    bool getTimestamp(uint32_t& available, timespec& time) override;
 
 private:
+    bool is_non_blocking_;
     std::unique_ptr<PCM> pcm_;
 };
 
@@ -12,8 +12,17 @@ public:
     std::shared_ptr<PCMData> getPCMData() const override;
     AudioFormat getAudioFormat() const override;
 
+    // Only the first maxBytes of the data chunk are read by load(), the
+    // remainder can be streamed from getDataOffset() later on.
+    void setResidentLimit(uint32_t maxBytes);
+    uint64_t getDataOffset() const;
+    uint32_t getDataSize() const;
+
 private:
     std::shared_ptr<PCMData> pcm_data_;
+    uint32_t resident_limit_;
+    uint64_t data_offset_;
+    uint32_t data_size_;
 };
 
 #endif // _WAV_PARSER_HPP__
@@ -0,0 +1,58 @@
+#ifndef _WAV_WRITER_HPP__
+#define _WAV_WRITER_HPP__
+
+#include <cstdint>
+#include <cstdlib>
+#include <memory>
+#include <string>
+
+#include "audio_utils.hpp"
+
+struct WavWriterOptions {
+    bool directIo{false};               // O_DIRECT, falls back to buffered I/O if unsupported
+    uint64_t preallocateBytes{0};       // reserve file extents this far ahead of the data
+    uint32_t blockSize{1 << 20};        // multiple of 4096
+};
+
+// Writes a WAVE_FORMAT_EXTENSIBLE file in large aligned blocks. The header
+// is written with placeholder sizes and patched by close(); recordings
+// larger than 4 GiB turn into RF64 through the reserved JUNK chunk.
+class WavWriter {
+public:
+    WavWriter() = default;
+    ~WavWriter();
+
+    bool open(const std::string& path, const AudioFormat& format, const WavWriterOptions& options = {});
+    bool write(const uint8_t* data, size_t bytes);
+    bool close();
+
+    uint64_t dataBytes() const {
+        return data_bytes_;
+    }
+
+    // copying is not allowed
+    WavWriter(const WavWriter&) = delete;
+    WavWriter& operator=(const WavWriter&) = delete;
+
+private:
+    struct FreeDeleter {
+        void operator()(uint8_t* block) const {
+            std::free(block);
+        }
+    };
+
+    bool flushBlock(size_t bytes);
+    void buildHeader(uint8_t* header) const;
+
+    int fd_{-1};
+    bool is_direct_{false};
+    AudioFormat format_;
+    WavWriterOptions options_;
+    std::unique_ptr<uint8_t, FreeDeleter> block_;
+    size_t block_fill_{0};
+    uint64_t file_offset_{0};
+    uint64_t allocated_{0};
+    uint64_t data_bytes_{0};
+};
+
+#endif // _WAV_WRITER_HPP__
@@ -0,0 +1,90 @@
+#ifndef _WORKER_POOL_HPP__
+#define _WORKER_POOL_HPP__
+
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+// Fork-join pool for the render thread. run() splits a batch of indexed
+// tasks evenly over the workers and the calling thread; whoever runs out of
+// work steals from the back of another participant's range, so a few heavy
+// tasks do not leave cores idle. Workers are pinned one per core unless
+// the pool is unpinned.
+//
+// Batches are expected once per period. Between them a worker spins for a
+// short while, then sleeps until shortly before the next period is due and
+// spins again, and only parks for good when no batch comes, e.g. while the
+// device is stopped. run() never allocates and only takes a lock when a
+// worker is parked.
+class WorkerPool {
+public:
+    // worker is 0 for the thread calling run(), 1..threads() for the pool.
+    using Task = void (*)(void* context, uint32_t task, uint32_t worker);
+    static constexpr uint32_t kMaxTasks = UINT16_MAX;
+    static constexpr int32_t kUnpinned = -1;
+
+    // period of zero disables the sleep before the next period. The workers
+    // are pinned to the cores after callerCore, where run() is expected.
+    // kUnpinned leaves them, like the caller, to the scheduler.
+    WorkerPool(uint32_t threads, std::chrono::nanoseconds period, int32_t callerCore = 0);
+    ~WorkerPool();
+
+    uint32_t threads() const {
+        return thread_count_;
+    }
+
+    // Returns when all count tasks have finished. One caller thread only.
+    void run(uint32_t count, Task task, void* context);
+
+    // Best effort, false when the core does not exist or is not allowed.
+    static bool pinToCore(uint32_t core);
+    static uint32_t coreOf(uint32_t worker, uint32_t callerCore, uint32_t cores) {
+        return (callerCore + worker) % cores;
+    }
+
+    // copying is not allowed
+    WorkerPool(const WorkerPool&) = delete;
+    WorkerPool& operator=(const WorkerPool&) = delete;
+
+private:
+    using Clock = std::chrono::steady_clock;
+
+    // batch epoch in the upper 32 bits, begin and end of the task range below
+    struct alignas(64) Range {
+        std::atomic<uint64_t> value{0};
+    };
+
+    void workerLoop(uint32_t worker);
+    uint32_t waitForBatch(uint32_t seen);
+    bool spinFor(uint32_t seen, std::chrono::nanoseconds duration) const;
+    void park(uint32_t seen, Clock::time_point deadline);
+    void work(uint32_t worker, uint32_t epoch);
+    bool claim(uint32_t participant, uint32_t epoch, bool isOwner, uint32_t& task);
+
+    uint32_t thread_count_;
+    int32_t caller_core_;
+    std::chrono::nanoseconds period_;
+    std::chrono::nanoseconds spin_;
+    std::unique_ptr<Range[]> ranges_;
+
+    // written by run() before the epoch is published
+    Task task_{nullptr};
+    void* context_{nullptr};
+
+    alignas(64) std::atomic<uint32_t> epoch_{0};
+    std::atomic<Clock::rep> batch_start_{0};
+    alignas(64) std::atomic<uint32_t> remaining_{0};
+    alignas(64) std::atomic<uint32_t> parked_{0};
+    std::mutex park_mutex_;
+    std::condition_variable park_condition_;
+
+    std::vector<std::thread> threads_;
+    std::atomic<bool> running_{true};
+};
+
+#endif // _WORKER_POOL_HPP__
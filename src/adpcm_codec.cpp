@@ -0,0 +1,169 @@
+#include <algorithm>
+#include <array>
+#include <cstring>
+
+#include "rpi_sound/adpcm_codec.hpp"
+
+namespace {
+    constexpr std::array<int16_t, 89> kStepTable{
+        7, 8, 9, 10, 11, 12, 13, 14, 16, 17, 19, 21, 23, 25, 28, 31, 34, 37, 41, 45,
+        50, 55, 60, 66, 73, 80, 88, 97, 107, 118, 130, 143, 157, 173, 190, 209, 230,
+        253, 279, 307, 337, 371, 408, 449, 494, 544, 598, 658, 724, 796, 876, 963,
+        1060, 1166, 1282, 1411, 1552, 1707, 1878, 2066, 2272, 2499, 2749, 3024, 3327,
+        3660, 4026, 4428, 4871, 5358, 5894, 6484, 7132, 7845, 8630, 9493, 10442,
+        11487, 12635, 13899, 15289, 16818, 18500, 20350, 22385, 24623, 27086, 29794,
+        32767
+    };
+    constexpr std::array<int8_t, 16> kIndexTable{
+        -1, -1, -1, -1, 2, 4, 6, 8,
+        -1, -1, -1, -1, 2, 4, 6, 8
+    };
+    constexpr uint32_t kHeaderBytesPerChannel{4};
+    constexpr uint32_t kFramesPerGroup{8};
+
+    inline int16_t decodeNibble(uint8_t nibble, int32_t& predictor, int32_t& index) {
+        int32_t step = kStepTable[index];
+        int32_t delta = step >> 3;
+        if (nibble & 4) {
+            delta += step;
+        }
+        if (nibble & 2) {
+            delta += step >> 1;
+        }
+        if (nibble & 1) {
+            delta += step >> 2;
+        }
+        predictor = std::clamp(predictor + ((nibble & 8) ? -delta : delta), -32768, 32767);
+        index = std::clamp(index + kIndexTable[nibble], 0, 88);
+        return static_cast<int16_t>(predictor);
+    }
+
+    inline uint8_t encodeSample(int32_t sample, int32_t& predictor, int32_t& index) {
+        int32_t step = kStepTable[index];
+        int32_t diff = sample - predictor;
+        uint8_t nibble = 0;
+        if (diff < 0) {
+            nibble = 8;
+            diff = -diff;
+        }
+        if (diff >= step) {
+            nibble |= 4;
+            diff -= step;
+        }
+        step >>= 1;
+        if (diff >= step) {
+            nibble |= 2;
+            diff -= step;
+        }
+        step >>= 1;
+        if (diff >= step) {
+            nibble |= 1;
+        }
+        // Track the decoder state so the encoder never drifts from it.
+        decodeNibble(nibble, predictor, index);
+        return nibble;
+    }
+}
+
+uint32_t AdpcmCodec::framesPerBlock(uint32_t blockAlign, uint16_t channels) {
+    return (blockAlign - kHeaderBytesPerChannel * channels) * 2 / channels + 1;
+}
+
+std::shared_ptr<AdpcmData> AdpcmCodec::encode(const PCMData& pcm) {
+    const auto channels = pcm.format.channels;
+    if (pcm.format.isFloat || pcm.format.bitsPerSample != 16 || channels == 0 || channels > kMaxChannels) {
+        return nullptr;
+    }
+
+    auto adpcm = std::make_shared<AdpcmData>();
+    adpcm->format = pcm.format;
+    adpcm->blockAlign = kBlockBytesPerChannel * channels;
+    adpcm->framesPerBlock = framesPerBlock(adpcm->blockAlign, channels);
+    adpcm->frameCount = static_cast<uint32_t>(pcm.data.size() / (channels * sizeof(int16_t)));
+    if (adpcm->frameCount == 0) {
+        return adpcm;
+    }
+
+    const auto* src = reinterpret_cast<const int16_t*>(pcm.data.data());
+    const auto lastFrame = adpcm->frameCount - 1;
+    // The last block is padded by repeating the last frame.
+    auto sampleAt = [&](uint32_t frame, uint16_t channel) -> int32_t {
+        return src[static_cast<size_t>(std::min(frame, lastFrame)) * channels + channel];
+    };
+
+    const auto blockCount = (adpcm->frameCount + adpcm->framesPerBlock - 1) / adpcm->framesPerBlock;
+    adpcm->blocks.resize(static_cast<size_t>(blockCount) * adpcm->blockAlign);
+
+    std::array<int32_t, kMaxChannels> predictor{};
+    std::array<int32_t, kMaxChannels> index{};
+    for (uint32_t block = 0; block < blockCount; ++block) {
+        auto* out = adpcm->blocks.data() + static_cast<size_t>(block) * adpcm->blockAlign;
+        const auto first = block * adpcm->framesPerBlock;
+
+        for (uint16_t ch = 0; ch < channels; ++ch) {
+            predictor[ch] = sampleAt(first, ch);
+            auto header = static_cast<int16_t>(predictor[ch]);
+            std::memcpy(out, &header, sizeof(header));
+            out[2] = static_cast<uint8_t>(index[ch]);
+            out[3] = 0;
+            out += kHeaderBytesPerChannel;
+        }
+
+        for (uint32_t frame = first + 1; frame < first + adpcm->framesPerBlock; frame += kFramesPerGroup) {
+            for (uint16_t ch = 0; ch < channels; ++ch) {
+                for (uint32_t i = 0; i < kFramesPerGroup; i += 2) {
+                    auto low = encodeSample(sampleAt(frame + i, ch), predictor[ch], index[ch]);
+                    auto high = encodeSample(sampleAt(frame + i + 1, ch), predictor[ch], index[ch]);
+                    *out++ = static_cast<uint8_t>(low | (high << 4));
+                }
+            }
+        }
+    }
+
+    return adpcm;
+}
+
+std::shared_ptr<PCMData> AdpcmCodec::decode(const AdpcmData& adpcm) {
+    const auto channels = adpcm.format.channels;
+    auto pcm = std::make_shared<PCMData>();
+    pcm->format = adpcm.format;
+    pcm->data.resize(static_cast<size_t>(adpcm.frameCount) * channels * sizeof(int16_t));
+
+    std::vector<int16_t> block(static_cast<size_t>(adpcm.framesPerBlock) * channels);
+    auto* out = reinterpret_cast<int16_t*>(pcm->data.data());
+    for (uint32_t frame = 0; frame < adpcm.frameCount; frame += adpcm.framesPerBlock) {
+        decodeBlock(adpcm, frame / adpcm.framesPerBlock, block.data());
+        auto frames = std::min(adpcm.framesPerBlock, adpcm.frameCount - frame);
+        std::copy_n(block.data(), static_cast<size_t>(frames) * channels, out + static_cast<size_t>(frame) * channels);
+    }
+    return pcm;
+}
+
+void AdpcmCodec::decodeBlock(const AdpcmData& adpcm, uint32_t block, int16_t* out) {
+    // The predictor is sequential within a channel, so the channels are
+    // decoded in lockstep to give the CPU independent chains to overlap.
+    const auto channels = adpcm.format.channels;
+    const auto* in = adpcm.blocks.data() + static_cast<size_t>(block) * adpcm.blockAlign;
+
+    std::array<int32_t, kMaxChannels> predictor;
+    std::array<int32_t, kMaxChannels> index;
+    for (uint16_t ch = 0; ch < channels; ++ch) {
+        int16_t header;
+        std::memcpy(&header, in, sizeof(header));
+        predictor[ch] = header;
+        index[ch] = std::min<int32_t>(in[2], 88);
+        out[ch] = header;
+        in += kHeaderBytesPerChannel;
+    }
+
+    for (uint32_t frame = 1; frame < adpcm.framesPerBlock; frame += kFramesPerGroup) {
+        auto* group = out + static_cast<size_t>(frame) * channels;
+        for (uint16_t ch = 0; ch < channels; ++ch) {
+            for (uint32_t i = 0; i < kFramesPerGroup; i += 2) {
+                auto byte = *in++;
+                group[i * channels + ch] = decodeNibble(byte & 0x0f, predictor[ch], index[ch]);
+                group[(i + 1) * channels + ch] = decodeNibble(byte >> 4, predictor[ch], index[ch]);
+            }
+        }
+    }
+}
@@ -0,0 +1,31 @@
+#include <iostream>
+
+#include "rpi_sound/adpcm_parser.hpp"
+#include "rpi_sound/wav_parser.hpp"
+
+bool AdpcmParser::load(const std::string_view& filePath) {
+    WavParser parser;
+    if (!parser.load(filePath)) {
+        return false;
+    }
+
+    auto adpcm = AdpcmCodec::encode(*parser.getPCMData());
+    if (!adpcm) {
+        std::cout << "Only 16-bit PCM can be compressed: " << filePath << "\r\n";
+        return false;
+    }
+    adpcm_data_ = std::move(adpcm);
+    return true;
+}
+
+std::shared_ptr<PCMData> AdpcmParser::getPCMData() const {
+    return adpcm_data_ ? AdpcmCodec::decode(*adpcm_data_) : nullptr;
+}
+
+AudioFormat AdpcmParser::getAudioFormat() const {
+    return adpcm_data_->format;
+}
+
+std::shared_ptr<const AdpcmData> AdpcmParser::getCompressedData() const {
+    return adpcm_data_;
+}
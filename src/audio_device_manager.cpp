@@ -46,6 +46,7 @@ bool AudioDeviceManager::parseCards(std::istream& cardsFile, std::vector<AudioDe
         std::smatch match;
         if (std::regex_match(line, match, lineRegex)) {
             device.card = std::atoi(match[1].str().c_str());
+            device.id = match[2].str();
             device.driver = match[3].str();
         } else if (std::regex_match(line, match, longnameRegex)) {
             device.description = match[1].str();
@@ -148,6 +149,10 @@ bool AudioDeviceManager::setDevice(int32_t cardId, int32_t deviceId, AudioDevice
     return driver_->openDevice(cardId, deviceId, type == AudioDevice::Type::kPlayback, defaultFormat);
 }
 
-void AudioDeviceManager::writeData(const std::vector<uint8_t>& data) {
-    driver_->writeData(data);
+bool AudioDeviceManager::writeData(const std::vector<uint8_t>& data) {
+    return driver_->writeData(data);
+}
+
+bool AudioDeviceManager::getTimestamp(uint32_t& available, timespec& time) {
+    return driver_->getTimestamp(available, time);
 }
\ No newline at end of file
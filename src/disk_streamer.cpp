@@ -0,0 +1,231 @@
+#include <algorithm>
+#include <cstring>
+#include <iostream>
+
+#include <fcntl.h>
+#include <poll.h>
+#include <sys/eventfd.h>
+#include <unistd.h>
+
+#include "rpi_sound/disk_streamer.hpp"
+
+namespace {
+    constexpr int kPollIntervalMs{5};
+    constexpr uint64_t kChunkBytes{32 * 1024};
+    constexpr uint64_t kPositionBits{48};
+    constexpr uint64_t kPositionMask{(1ULL << kPositionBits) - 1};
+
+    constexpr uint64_t pack(uint16_t serial, uint64_t position) {
+        return (static_cast<uint64_t>(serial) << kPositionBits) | (position & kPositionMask);
+    }
+    constexpr uint16_t serialOf(uint64_t state) {
+        return static_cast<uint16_t>(state >> kPositionBits);
+    }
+    constexpr uint64_t positionOf(uint64_t state) {
+        return state & kPositionMask;
+    }
+}
+
+DiskStreamer::DiskStreamer(const AudioFormat& format, uint32_t bufferFrames, uint32_t streamCount) :
+    frame_size_{static_cast<uint32_t>(format.channels * (format.bitsPerSample / 8))},
+    ring_size_{static_cast<uint64_t>(bufferFrames) * frame_size_},
+    stream_count_{streamCount},
+    streams_{std::make_unique<Stream[]>(streamCount)} {
+    for (uint32_t i = 0; i < stream_count_; ++i) {
+        streams_[i].ring = std::make_unique<uint8_t[]>(ring_size_);
+    }
+}
+
+DiskStreamer::~DiskStreamer() {
+    stop();
+}
+
+bool DiskStreamer::start() {
+    if (running_) {
+        return true;
+    }
+    wake_fd_ = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+    if (wake_fd_ < 0) {
+        std::cout << "Disk streamer init failed!\r\n";
+        return false;
+    }
+    running_ = true;
+    thread_ = std::thread(&DiskStreamer::run, this);
+    return true;
+}
+
+void DiskStreamer::stop() {
+    if (running_.exchange(false)) {
+        wake();
+    }
+    if (thread_.joinable()) {
+        thread_.join();
+    }
+    for (uint32_t i = 0; i < stream_count_; ++i) {
+        closeFile(streams_[i]);
+    }
+    if (wake_fd_ >= 0) {
+        ::close(wake_fd_);
+        wake_fd_ = -1;
+    }
+}
+
+bool DiskStreamer::open(uint32_t stream, const Sample& sample) {
+    if (stream >= stream_count_ || !sample.file) {
+        open_failures_.fetch_add(1, std::memory_order_relaxed);
+        return false;
+    }
+
+    auto& s = streams_[stream];
+    s.serial = s.serial == UINT16_MAX ? 1 : s.serial + 1;
+    s.readPos = 0;
+    s.readState.store(pack(s.serial, 0), std::memory_order_release);
+
+    Request request{
+        .stream = stream,
+        .serial = s.serial,
+        .offset = sample.dataOffset + static_cast<uint64_t>(sample.residentFrames) * frame_size_,
+        .size = static_cast<uint64_t>(sample.frameCount - sample.residentFrames) * frame_size_,
+        .file = sample.file
+    };
+    if (!requests_.push(request)) {
+        open_failures_.fetch_add(1, std::memory_order_relaxed);
+        return false;
+    }
+    wake();
+    return true;
+}
+
+uint32_t DiskStreamer::read(uint32_t stream, uint8_t* data, uint32_t frames) {
+    auto& s = streams_[stream];
+    auto writeState = s.writeState.load(std::memory_order_acquire);
+    if (serialOf(writeState) != s.serial || positionOf(writeState) <= s.readPos) {
+        return 0;
+    }
+
+    auto bytes = std::min<uint64_t>(positionOf(writeState) - s.readPos,
+                                    static_cast<uint64_t>(frames) * frame_size_);
+    bytes -= bytes % frame_size_;
+    auto offset = s.readPos % ring_size_;
+    auto first = std::min(bytes, ring_size_ - offset);
+    std::memcpy(data, s.ring.get() + offset, first);
+    std::memcpy(data + first, s.ring.get(), bytes - first);
+
+    s.readPos += bytes;
+    s.readState.store(pack(s.serial, s.readPos), std::memory_order_release);
+    return static_cast<uint32_t>(bytes / frame_size_);
+}
+
+void DiskStreamer::drop(uint32_t stream, uint32_t frames) {
+    // The prefetch thread skips the same amount of the file, so the stream
+    // stays in time with the voice after an underrun.
+    auto& s = streams_[stream];
+    s.readPos += static_cast<uint64_t>(frames) * frame_size_;
+    s.readState.store(pack(s.serial, s.readPos), std::memory_order_release);
+    underruns_.fetch_add(1, std::memory_order_relaxed);
+}
+
+void DiskStreamer::close(uint32_t stream) {
+    auto& s = streams_[stream];
+    s.serial = s.serial == UINT16_MAX ? 1 : s.serial + 1;
+    s.readPos = 0;
+    s.readState.store(pack(s.serial, 0), std::memory_order_release);
+}
+
+void DiskStreamer::run() {
+    pollfd pfd{wake_fd_, POLLIN, 0};
+    while (running_) {
+        poll(&pfd, 1, kPollIntervalMs);
+        uint64_t value;
+        [[maybe_unused]] auto ret = ::read(wake_fd_, &value, sizeof(value));
+
+        Request request;
+        while (requests_.pop(request)) {
+            openRequest(request);
+        }
+        // the last request would otherwise keep its file open
+        request.file.reset();
+
+        // Round-robin in chunks so a long read does not starve other voices.
+        auto isBusy{true};
+        while (isBusy && running_) {
+            isBusy = false;
+            for (uint32_t i = 0; i < stream_count_; ++i) {
+                isBusy |= fill(streams_[i]);
+            }
+        }
+    }
+}
+
+void DiskStreamer::openRequest(const Request& request) {
+    auto& s = streams_[request.stream];
+    closeFile(s);
+    if (serialOf(s.readState.load(std::memory_order_acquire)) != request.serial) {
+        return;
+    }
+
+    s.file = request.file;
+    posix_fadvise(s.file->fd(), static_cast<off_t>(request.offset), static_cast<off_t>(request.size), POSIX_FADV_SEQUENTIAL);
+
+    s.ioSerial = request.serial;
+    s.writePos = 0;
+    s.fileOffset = request.offset;
+    s.remaining = request.size;
+    s.writeState.store(pack(s.ioSerial, 0), std::memory_order_release);
+}
+
+bool DiskStreamer::fill(Stream& s) {
+    if (!s.file) {
+        return false;
+    }
+    auto readState = s.readState.load(std::memory_order_acquire);
+    if (serialOf(readState) != s.ioSerial) {
+        closeFile(s);
+        return false;
+    }
+
+    auto readPos = positionOf(readState);
+    if (readPos > s.writePos) {
+        auto skipped = std::min(readPos - s.writePos, s.remaining);
+        s.fileOffset += skipped;
+        s.remaining -= skipped;
+        s.writePos = readPos;
+    }
+
+    auto bytes = std::min({ring_size_ - (s.writePos - readPos), s.remaining, kChunkBytes});
+    bytes -= bytes % frame_size_;
+    if (bytes == 0) {
+        if (s.remaining == 0) {
+            closeFile(s);
+        }
+        return false;
+    }
+
+    auto offset = s.writePos % ring_size_;
+    auto first = std::min(bytes, ring_size_ - offset);
+    auto got = pread(s.file->fd(), s.ring.get() + offset, first, static_cast<off_t>(s.fileOffset));
+    if (got == static_cast<ssize_t>(first) && bytes > first) {
+        auto second = pread(s.file->fd(), s.ring.get(), bytes - first, static_cast<off_t>(s.fileOffset + first));
+        got += std::max<ssize_t>(second, 0);
+    }
+    if (got <= 0) {
+        closeFile(s);
+        return false;
+    }
+
+    auto written = static_cast<uint64_t>(got) - static_cast<uint64_t>(got) % frame_size_;
+    s.writePos += written;
+    s.fileOffset += written;
+    s.remaining -= std::min(written, s.remaining);
+    s.writeState.store(pack(s.ioSerial, s.writePos), std::memory_order_release);
+    return true;
+}
+
+void DiskStreamer::closeFile(Stream& s) {
+    s.file.reset();
+}
+
+void DiskStreamer::wake() {
+    uint64_t one = 1;
+    [[maybe_unused]] auto ret = ::write(wake_fd_, &one, sizeof(one));
+}
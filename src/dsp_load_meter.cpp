@@ -0,0 +1,82 @@
+#include <algorithm>
+
+#include "rpi_sound/dsp_load_meter.hpp"
+
+namespace {
+    // weight of the newest period in the rolling averages
+    constexpr double kSmoothing{1.0 / 32};
+}
+
+DspLoadMeter::DspLoadMeter(const HWAudioFormat& format) :
+    deadline_ns_{1e9 * format.periodSize / std::max(format.audioFormat.sampleRate, 1U)} {}
+
+void DspLoadMeter::beginPeriod() {
+    if (is_pending_) {
+        publish();
+    }
+    stage_ns_.fill(0);
+    last_mark_ = Clock::now();
+    is_pending_ = true;
+}
+
+void DspLoadMeter::mark(Stage stage) {
+    auto now = Clock::now();
+    stage_ns_[stage] += std::chrono::duration<double, std::nano>(now - last_mark_).count();
+    last_mark_ = now;
+}
+
+DspLoadMeter::Snapshot DspLoadMeter::snapshot() const {
+    Snapshot snapshot{};
+    uint32_t sequence;
+    do {
+        sequence = sequence_.load(std::memory_order_acquire);
+        snapshot.periods = published_periods_.load(std::memory_order_relaxed);
+        snapshot.deadlineMisses = published_misses_.load(std::memory_order_relaxed);
+        snapshot.load = published_load_.load(std::memory_order_relaxed);
+        snapshot.peakLoad = published_peak_load_.load(std::memory_order_relaxed);
+        for (size_t stage = 0; stage < kStageCount; ++stage) {
+            snapshot.averageUs[stage] = published_average_ns_[stage].load(std::memory_order_relaxed) / 1000;
+            snapshot.worstUs[stage] = published_worst_ns_[stage].load(std::memory_order_relaxed) / 1000;
+        }
+        std::atomic_thread_fence(std::memory_order_acquire);
+    } while ((sequence & 1) || sequence != sequence_.load(std::memory_order_relaxed));
+
+    snapshot.deadlineUs = deadline_ns_ / 1000;
+    return snapshot;
+}
+
+void DspLoadMeter::publish() {
+    double busy = 0;
+    for (size_t stage = 0; stage < kStageCount; ++stage) {
+        if (stage != kDriverWrite) {
+            busy += stage_ns_[stage];
+        }
+    }
+
+    auto periodLoad = 100 * busy / deadline_ns_;
+    auto isFirst = periods_ == 0;
+    ++periods_;
+    if (busy > deadline_ns_) {
+        ++misses_;
+    }
+    load_ = isFirst ? periodLoad : load_ + kSmoothing * (periodLoad - load_);
+    peak_load_ = std::max(peak_load_, periodLoad);
+    for (size_t stage = 0; stage < kStageCount; ++stage) {
+        average_ns_[stage] = isFirst ? stage_ns_[stage] :
+                             average_ns_[stage] + kSmoothing * (stage_ns_[stage] - average_ns_[stage]);
+        worst_ns_[stage] = std::max(worst_ns_[stage], stage_ns_[stage]);
+    }
+
+    auto sequence = sequence_.load(std::memory_order_relaxed);
+    sequence_.store(sequence + 1, std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_release);
+    published_periods_.store(periods_, std::memory_order_relaxed);
+    published_misses_.store(misses_, std::memory_order_relaxed);
+    published_load_.store(load_, std::memory_order_relaxed);
+    published_peak_load_.store(peak_load_, std::memory_order_relaxed);
+    for (size_t stage = 0; stage < kStageCount; ++stage) {
+        published_average_ns_[stage].store(average_ns_[stage], std::memory_order_relaxed);
+        published_worst_ns_[stage].store(worst_ns_[stage], std::memory_order_relaxed);
+    }
+    sequence_.store(sequence + 2, std::memory_order_release);
+}
@@ -0,0 +1,285 @@
+#include <algorithm>
+#include <array>
+#include <cerrno>
+#include <cstdio>
+#include <fstream>
+#include <iostream>
+
+#include <poll.h>
+#include <sys/eventfd.h>
+#include <sys/inotify.h>
+#include <unistd.h>
+
+#include "rpi_sound/audio_device_manager.hpp"
+#include "rpi_sound/failover_device.hpp"
+
+namespace {
+    constexpr int32_t kMaxCards{32};
+    // udev fixes the permissions after the node is created, hence IN_ATTRIB
+    constexpr uint32_t kWatchMask{IN_CREATE | IN_DELETE | IN_ATTRIB};
+    constexpr std::chrono::milliseconds kMinRetryDelay{100};
+    constexpr std::chrono::milliseconds kMaxRetryDelay{10000};
+    // a card failing again within this time of being reopened doubles the delay
+    constexpr std::chrono::seconds kStableTime{5};
+
+    // "pcmC1D0p" is card 1, device 0, playback
+    bool parsePlaybackNode(const char* name, int32_t& card, int32_t& device) {
+        char direction{0};
+        return std::sscanf(name, "pcmC%dD%d%c", &card, &device, &direction) == 3 && direction == 'p';
+    }
+}
+
+FailoverDevice::FailoverDevice(DriverFactory factory, std::string devicePath, std::string procPath) :
+    factory_{std::move(factory)},
+    device_path_{std::move(devicePath)},
+    proc_path_{std::move(procPath)} {}
+
+FailoverDevice::~FailoverDevice() {
+    if (running_.exchange(false)) {
+        wake();
+    }
+    if (thread_.joinable()) {
+        thread_.join();
+    }
+    if (inotify_fd_ >= 0) {
+        close(inotify_fd_);
+    }
+    if (wake_fd_ >= 0) {
+        close(wake_fd_);
+    }
+}
+
+std::vector<AudioDevice> FailoverDevice::listDevices() {
+    devices_ = AudioDeviceManager{factory_()}.listDevices();
+    return devices_;
+}
+
+bool FailoverDevice::setDevice(int32_t cardId, int32_t deviceId, AudioDevice::Type type) {
+    if (type != AudioDevice::Type::kPlayback || running_) {
+        std::cout << "Failover is only supported for one playback device\r\n";
+        return false;
+    }
+
+    auto driver = factory_();
+    auto format = formatOf(cardId, deviceId, *driver);
+    if (!driver->openDevice(cardId, deviceId, true, format)) {
+        return false;
+    }
+    primary_ = std::move(driver);
+    primary_id_ = readCardId(cardId);
+    primary_card_ = cardId;
+    primary_device_ = deviceId;
+    primary_format_ = format;
+    state_ = kPrimary;
+
+    inotify_fd_ = inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+    wake_fd_ = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+    if (inotify_fd_ < 0 || wake_fd_ < 0 || inotify_add_watch(inotify_fd_, device_path_.c_str(), kWatchMask) < 0) {
+        std::cout << "Device watcher init failed, no failover!\r\n";
+        return true;
+    }
+    running_ = true;
+    thread_ = std::thread(&FailoverDevice::run, this);
+    return true;
+}
+
+bool FailoverDevice::setFallback(const std::string& cardId, int32_t deviceId) {
+    auto card = findCard(cardId);
+    if (card < 0) {
+        std::cout << "Fallback card not found: " << cardId << "\r\n";
+        return false;
+    }
+
+    // Same format as the primary so the engine does not notice the switch.
+    auto driver = factory_();
+    auto format = primary_format_;
+    if (!driver->openDevice(card, deviceId, true, format)) {
+        const auto& audio = primary_format_.audioFormat;
+        std::cout << "Fallback Card " << card << " Device " << deviceId << " can't play the primary format ("
+                  << audio.sampleRate << " Hz, " << audio.channels << " channels, " << audio.bitsPerSample
+                  << (audio.isFloat ? " bits float" : " bits") << "), no failover!\r\n";
+        return false;
+    }
+    fallback_ = std::move(driver);
+    std::cout << "Fallback: Card " << card << " Device " << deviceId << "\r\n";
+    return true;
+}
+
+bool FailoverDevice::writeData(const std::vector<uint8_t>& data) {
+    auto state = state_.load(std::memory_order_acquire);
+    if (state == kPrimaryReady) {
+        state = kPrimary;
+        state_.store(kPrimary, std::memory_order_relaxed);
+    }
+    if (state == kPrimary) {
+        if (!is_primary_gone_.load(std::memory_order_relaxed) && primary_->writeData(data)) {
+            return true;
+        }
+        // The watcher thread closes the primary, this period goes to the fallback.
+        state_.store(kFallback, std::memory_order_release);
+        failovers_.fetch_add(1, std::memory_order_relaxed);
+        wake();
+    }
+    return fallback_ && fallback_->writeData(data);
+}
+
+bool FailoverDevice::getTimestamp(uint32_t& available, timespec& time) {
+    if (state_.load(std::memory_order_acquire) == kPrimary) {
+        return primary_->getTimestamp(available, time);
+    }
+    return fallback_ && fallback_->getTimestamp(available, time);
+}
+
+bool FailoverDevice::isOnFallback() const {
+    return state_.load(std::memory_order_relaxed) != kPrimary;
+}
+
+uint32_t FailoverDevice::failovers() const {
+    return failovers_.load(std::memory_order_relaxed);
+}
+
+void FailoverDevice::run() {
+    std::array<pollfd, 2> fds{pollfd{inotify_fd_, POLLIN, 0}, pollfd{wake_fd_, POLLIN, 0}};
+    alignas(inotify_event) std::array<char, 4096> events;
+
+    while (running_) {
+        auto ret = poll(fds.data(), fds.size(), retryTimeoutMs());
+        if (ret < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            std::cout << "Device watcher poll failed!\r\n";
+            break;
+        }
+        if (fds[1].revents & POLLIN) {
+            uint64_t count;
+            [[maybe_unused]] auto drained = read(wake_fd_, &count, sizeof(count));
+        }
+        if (!running_) {
+            break;
+        }
+
+        if (state_.load(std::memory_order_acquire) == kFallback && primary_) {
+            primary_.reset();
+            std::cout << "Card " << primary_id_ << " lost, playing on fallback\r\n";
+            if (!is_primary_gone_) {
+                // the write failed but the card is still there
+                scheduleRetry();
+            }
+        }
+        if (is_retry_pending_ && std::chrono::steady_clock::now() >= retry_at_) {
+            is_retry_pending_ = false;
+            // once the node is gone, its events bring the card back
+            if (!is_primary_gone_ && !primary_ && !reopenPrimary(primary_card_)) {
+                scheduleRetry();
+            }
+        }
+        if (fds[0].revents & POLLIN) {
+            ssize_t length;
+            while ((length = read(inotify_fd_, events.data(), events.size())) > 0) {
+                handleEvents(events.data(), static_cast<size_t>(length));
+            }
+        }
+    }
+}
+
+void FailoverDevice::wake() {
+    if (wake_fd_ >= 0) {
+        uint64_t one = 1;
+        [[maybe_unused]] auto ret = write(wake_fd_, &one, sizeof(one));
+    }
+}
+
+void FailoverDevice::handleEvents(const char* buffer, size_t length) {
+    for (const char* next = buffer; next < buffer + length;) {
+        const auto* event = reinterpret_cast<const inotify_event*>(next);
+        next += sizeof(inotify_event) + event->len;
+
+        int32_t card;
+        int32_t device;
+        if (event->len == 0 || !parsePlaybackNode(event->name, card, device)) {
+            continue;
+        }
+        if (event->mask & IN_DELETE) {
+            std::cout << "Playback removed: Card " << card << " Device " << device << "\r\n";
+            if (card == primary_card_ && device == primary_device_) {
+                // picked up by the render thread on its next write
+                is_primary_gone_ = true;
+            }
+            continue;
+        }
+        if (event->mask & IN_CREATE) {
+            std::cout << "Playback added: Card " << card << " [" << readCardId(card) << "] Device " << device << "\r\n";
+        }
+        if (state_.load(std::memory_order_acquire) == kFallback && !primary_ &&
+            device == primary_device_ && readCardId(card) == primary_id_) {
+            reopenPrimary(card);
+        }
+    }
+}
+
+bool FailoverDevice::reopenPrimary(int32_t card) {
+    last_attempt_ = std::chrono::steady_clock::now();
+    auto driver = factory_();
+    auto format = primary_format_;
+    if (!driver->openDevice(card, primary_device_, true, format)) {
+        // e.g. no permissions yet, retried on the next event of the node
+        return false;
+    }
+    primary_ = std::move(driver);
+    primary_card_ = card;
+    is_primary_gone_ = false;
+    is_retry_pending_ = false;
+    std::cout << "Card " << primary_id_ << " back as Card " << card << "\r\n";
+    state_.store(kPrimaryReady, std::memory_order_release);
+    return true;
+}
+
+void FailoverDevice::scheduleRetry() {
+    auto now = std::chrono::steady_clock::now();
+    if (now - last_attempt_ < kStableTime) {
+        retry_delay_ = std::clamp(retry_delay_ * 2, kMinRetryDelay, kMaxRetryDelay);
+    } else {
+        retry_delay_ = kMinRetryDelay;
+    }
+    retry_at_ = now + retry_delay_;
+    is_retry_pending_ = true;
+}
+
+int FailoverDevice::retryTimeoutMs() const {
+    if (!is_retry_pending_) {
+        return -1;
+    }
+    auto left = std::chrono::ceil<std::chrono::milliseconds>(retry_at_ - std::chrono::steady_clock::now());
+    return static_cast<int>(std::max<int64_t>(left.count(), 0));
+}
+
+std::string FailoverDevice::readCardId(int32_t card) const {
+    std::ifstream file{proc_path_ + "/card" + std::to_string(card) + "/id"};
+    std::string id;
+    std::getline(file, id);
+    return id;
+}
+
+int32_t FailoverDevice::findCard(const std::string& cardId) const {
+    for (int32_t card = 0; card < kMaxCards; ++card) {
+        if (readCardId(card) == cardId) {
+            return card;
+        }
+    }
+    return -1;
+}
+
+HWAudioFormat FailoverDevice::formatOf(int32_t card, int32_t deviceId, IAudioDriver& driver) const {
+    for (const auto& device : devices_) {
+        if (device.card != card) {
+            continue;
+        }
+        for (const auto& [subDeviceId, type, format] : device.device) {
+            if (subDeviceId == deviceId && type == AudioDevice::Type::kPlayback) {
+                return format;
+            }
+        }
+    }
+    return driver.getDefaultFormat();
+}
@@ -0,0 +1,72 @@
+#include <algorithm>
+#include <cmath>
+
+#include "rpi_sound/frame_clock.hpp"
+
+namespace {
+    constexpr int64_t kNanosecondsPerSecond{1000000000};
+    constexpr uint32_t kMaxErrorMs{5};
+    constexpr double kMaxDrift{0.01};   // no sound card is off by more than 1%
+}
+
+FrameClock::FrameClock(uint32_t sampleRate) :
+    nominal_rate_{static_cast<double>(sampleRate) / kNanosecondsPerSecond},
+    max_error_frames_{static_cast<int64_t>(sampleRate) * kMaxErrorMs / 1000},
+    rate_{nominal_rate_} {}
+
+int64_t FrameClock::now() {
+    timespec time{};
+    clock_gettime(CLOCK_MONOTONIC, &time);
+    return toNanoseconds(time);
+}
+
+int64_t FrameClock::toNanoseconds(const timespec& time) {
+    return static_cast<int64_t>(time.tv_sec) * kNanosecondsPerSecond + time.tv_nsec;
+}
+
+void FrameClock::addSample(int64_t time, int64_t frame) {
+    if (isLocked() && std::abs(frameAt(time) - frame) > max_error_frames_) {
+        reset();
+    }
+    times_[next_] = time;
+    frames_[next_] = frame;
+    next_ = (next_ + 1) % kSamples;
+    count_ = std::min(count_ + 1, kSamples);
+    base_time_ = time;
+    base_frame_ = frame;
+    fit();
+}
+
+void FrameClock::reset() {
+    next_ = 0;
+    count_ = 0;
+    rate_ = nominal_rate_;
+}
+
+int64_t FrameClock::frameAt(int64_t time) const {
+    auto elapsed = static_cast<double>(time - base_time_) - mean_time_;
+    return base_frame_ + std::llround(mean_frame_ + rate_ * elapsed);
+}
+
+void FrameClock::fit() {
+    const auto n = static_cast<double>(count_);
+    double sumTime{0};
+    double sumFrame{0};
+    for (size_t i = 0; i < count_; ++i) {
+        sumTime += static_cast<double>(times_[i] - base_time_);
+        sumFrame += static_cast<double>(frames_[i] - base_frame_);
+    }
+    mean_time_ = sumTime / n;
+    mean_frame_ = sumFrame / n;
+
+    double covariance{0};
+    double variance{0};
+    for (size_t i = 0; i < count_; ++i) {
+        auto time = static_cast<double>(times_[i] - base_time_) - mean_time_;
+        auto frame = static_cast<double>(frames_[i] - base_frame_) - mean_frame_;
+        covariance += time * frame;
+        variance += time * time;
+    }
+    rate_ = variance > 0 ? covariance / variance : nominal_rate_;
+    rate_ = std::clamp(rate_, nominal_rate_ * (1 - kMaxDrift), nominal_rate_ * (1 + kMaxDrift));
+}
@@ -0,0 +1,310 @@
+#include <algorithm>
+#include <array>
+#include <cmath>
+#include <numbers>
+
+#include "rpi_sound/interpolator.hpp"
+
+namespace {
+    constexpr uint32_t kBlockFrames{64};
+    constexpr double kSincCutoff{0.9};      // of Nyquist, leaves room for the short window
+    // A voice pitched up by step needs the cutoff scaled by 1 / step, or what
+    // is above the new Nyquist aliases. One table per half octave, 2^(-k/2),
+    // down to 1/4 for the two octaves of RenderEngine::kMaxPitchCents.
+    constexpr uint32_t kCutoffSteps{5};
+
+    template <typename Coefficient, uint32_t Taps>
+    using Coefficients = std::array<std::array<Coefficient, kBlockFrames>, Taps>;
+
+    // Blackman windowed sinc, each phase normalised to unity gain at DC.
+    template <uint32_t Phases>
+    std::array<std::array<double, Interpolator::kMaxTaps>, Phases + 1> makeSincTable(double cutoff) {
+        constexpr double kHalfWidth = Interpolator::kMaxTaps / 2;
+        std::array<std::array<double, Interpolator::kMaxTaps>, Phases + 1> table{};
+        for (uint32_t phase = 0; phase <= Phases; ++phase) {
+            auto fraction = static_cast<double>(phase) / Phases;
+            double sum{0};
+            for (uint32_t tap = 0; tap < Interpolator::kMaxTaps; ++tap) {
+                auto x = static_cast<double>(tap) - Interpolator::kHistory - fraction;
+                auto arg = std::numbers::pi * cutoff * x;
+                auto sinc = x == 0 ? 1.0 : std::sin(arg) / arg;
+                auto window = 0.42 + 0.5 * std::cos(std::numbers::pi * x / kHalfWidth) +
+                              0.08 * std::cos(2 * std::numbers::pi * x / kHalfWidth);
+                table[phase][tap] = sinc * window;
+                sum += table[phase][tap];
+            }
+            for (auto& coefficient : table[phase]) {
+                coefficient /= sum;
+            }
+        }
+        return table;
+    }
+
+    // the table with the highest cutoff that is still below the new Nyquist
+    uint32_t sincTableFor(uint64_t increment) {
+        if (increment <= Interpolator::kUnity) {
+            return 0;
+        }
+        auto halfOctaves = 2 * std::log2(static_cast<double>(increment) / static_cast<double>(Interpolator::kUnity));
+        return std::min(static_cast<uint32_t>(std::ceil(halfOctaves - 1e-9)), kCutoffSteps - 1);
+    }
+
+    double cutoffOf(uint32_t table) {
+        return kSincCutoff * std::exp2(-0.5 * table);
+    }
+
+#ifdef RPI_SOUND_FIXED_POINT
+    using Fraction = int32_t;       // Q14
+    using Coefficient = int32_t;    // Q14
+    using Accumulator = int32_t;
+    constexpr uint32_t kCoefficientBits{14};
+    constexpr Coefficient kOne{1 << kCoefficientBits};
+    // nearest phase instead of a blend, which keeps every row at exactly kOne
+    constexpr uint32_t kSincPhaseBits{10};
+    constexpr uint32_t kSincPhases{1u << kSincPhaseBits};
+
+    using SincTable = std::array<std::array<int16_t, Interpolator::kMaxTaps>, kSincPhases + 1>;
+
+    SincTable makeFixedSincTable(double cutoff) {
+        auto exact = makeSincTable<kSincPhases>(cutoff);
+        SincTable table{};
+        for (uint32_t phase = 0; phase <= kSincPhases; ++phase) {
+            int32_t sum{0};
+            for (uint32_t tap = 0; tap < Interpolator::kMaxTaps; ++tap) {
+                table[phase][tap] = static_cast<int16_t>(std::lround(exact[phase][tap] * kOne));
+                sum += table[phase][tap];
+            }
+            // rounding error goes to the centre tap
+            table[phase][Interpolator::kHistory] = static_cast<int16_t>(table[phase][Interpolator::kHistory] + kOne - sum);
+        }
+        return table;
+    }
+
+    std::array<SincTable, kCutoffSteps> makeSincTables() {
+        std::array<SincTable, kCutoffSteps> tables;
+        for (uint32_t table = 0; table < kCutoffSteps; ++table) {
+            tables[table] = makeFixedSincTable(cutoffOf(table));
+        }
+        return tables;
+    }
+
+    const std::array<SincTable, kCutoffSteps> kSincTables = makeSincTables();
+
+    inline Fraction toFraction(uint32_t fraction) {
+        return static_cast<Fraction>(fraction >> (32 - kCoefficientBits));
+    }
+
+    inline int32_t applyGain(Accumulator sum, int32_t gain) {
+        return static_cast<int32_t>((static_cast<int64_t>(sum) * gain) >> (kCoefficientBits + 15));
+    }
+
+    struct Linear {
+        static constexpr uint32_t kTaps = 2;
+        static void compute(const Fraction* fraction, uint32_t frames, Coefficients<Coefficient, kTaps>& c) {
+            for (uint32_t i = 0; i < frames; ++i) {
+                c[0][i] = kOne - fraction[i];
+                c[1][i] = fraction[i];
+            }
+        }
+    };
+
+    struct Cubic {
+        static constexpr uint32_t kTaps = 4;
+        static void compute(const Fraction* fraction, uint32_t frames, Coefficients<Coefficient, kTaps>& c) {
+            for (uint32_t i = 0; i < frames; ++i) {
+                auto t = fraction[i];
+                auto t2 = (t * t) >> kCoefficientBits;
+                auto t3 = (t2 * t) >> kCoefficientBits;
+                c[0][i] = (-t3 + 2 * t2 - t) >> 1;
+                c[1][i] = ((3 * t3 - 5 * t2) >> 1) + kOne;
+                c[2][i] = (-3 * t3 + 4 * t2 + t) >> 1;
+                // keeps the sum at exactly kOne
+                c[3][i] = kOne - c[0][i] - c[1][i] - c[2][i];
+            }
+        }
+    };
+
+    struct Sinc {
+        static constexpr uint32_t kTaps = Interpolator::kMaxTaps;
+        const SincTable& table;
+        void compute(const Fraction* fraction, uint32_t frames, Coefficients<Coefficient, kTaps>& c) const {
+            constexpr uint32_t kShift = kCoefficientBits - kSincPhaseBits;
+            for (uint32_t i = 0; i < frames; ++i) {
+                const auto& row = table[(fraction[i] + (1 << (kShift - 1))) >> kShift];
+                for (uint32_t tap = 0; tap < kTaps; ++tap) {
+                    c[tap][i] = row[tap];
+                }
+            }
+        }
+    };
+#else
+    using Fraction = float;
+    using Coefficient = float;
+    using Accumulator = float;
+    constexpr uint32_t kSincPhases{256};
+    constexpr float kFractionScale{1.0f / 4294967296.0f};
+
+    using SincTable = std::array<std::array<float, Interpolator::kMaxTaps>, kSincPhases + 1>;
+
+    SincTable makeFloatSincTable(double cutoff) {
+        auto exact = makeSincTable<kSincPhases>(cutoff);
+        SincTable table{};
+        for (uint32_t phase = 0; phase <= kSincPhases; ++phase) {
+            for (uint32_t tap = 0; tap < Interpolator::kMaxTaps; ++tap) {
+                table[phase][tap] = static_cast<float>(exact[phase][tap]);
+            }
+        }
+        return table;
+    }
+
+    std::array<SincTable, kCutoffSteps> makeSincTables() {
+        std::array<SincTable, kCutoffSteps> tables;
+        for (uint32_t table = 0; table < kCutoffSteps; ++table) {
+            tables[table] = makeFloatSincTable(cutoffOf(table));
+        }
+        return tables;
+    }
+
+    const std::array<SincTable, kCutoffSteps> kSincTables = makeSincTables();
+
+    inline Fraction toFraction(uint32_t fraction) {
+        return static_cast<float>(fraction) * kFractionScale;
+    }
+
+    inline int32_t applyGain(Accumulator sum, int32_t gain) {
+        return static_cast<int32_t>(sum * (static_cast<float>(gain) / 32768.0f));
+    }
+
+    struct Linear {
+        static constexpr uint32_t kTaps = 2;
+        static void compute(const Fraction* fraction, uint32_t frames, Coefficients<Coefficient, kTaps>& c) {
+            for (uint32_t i = 0; i < frames; ++i) {
+                c[0][i] = 1.0f - fraction[i];
+                c[1][i] = fraction[i];
+            }
+        }
+    };
+
+    struct Cubic {
+        static constexpr uint32_t kTaps = 4;
+        static void compute(const Fraction* fraction, uint32_t frames, Coefficients<Coefficient, kTaps>& c) {
+            for (uint32_t i = 0; i < frames; ++i) {
+                auto t = fraction[i];
+                auto t2 = t * t;
+                auto t3 = t2 * t;
+                c[0][i] = -0.5f * t3 + t2 - 0.5f * t;
+                c[1][i] = 1.5f * t3 - 2.5f * t2 + 1.0f;
+                c[2][i] = -1.5f * t3 + 2.0f * t2 + 0.5f * t;
+                c[3][i] = 0.5f * t3 - 0.5f * t2;
+            }
+        }
+    };
+
+    struct Sinc {
+        static constexpr uint32_t kTaps = Interpolator::kMaxTaps;
+        const SincTable& table;
+        void compute(const Fraction* fraction, uint32_t frames, Coefficients<Coefficient, kTaps>& c) const {
+            // linear between the two nearest table phases
+            for (uint32_t i = 0; i < frames; ++i) {
+                auto scaled = fraction[i] * kSincPhases;
+                auto phase = std::min(static_cast<uint32_t>(scaled), kSincPhases - 1);
+                auto blend = scaled - static_cast<float>(phase);
+                const auto& lower = table[phase];
+                const auto& upper = table[phase + 1];
+                for (uint32_t tap = 0; tap < kTaps; ++tap) {
+                    c[tap][i] = lower[tap] + (upper[tap] - lower[tap]) * blend;
+                }
+            }
+        }
+    };
+#endif
+
+    // Channels of 0 reads the channel count at runtime.
+    template <typename Kernel, uint16_t Channels>
+    void mixKernel(const Kernel& kernel, const Interpolator::Sample* src, uint16_t channels, uint64_t position, uint64_t increment,
+                   uint32_t frames, int32_t gain, int32_t* dst) {
+        constexpr uint32_t kTaps = Kernel::kTaps;
+        constexpr uint32_t kBefore = kTaps / 2 - 1;
+        constexpr uint16_t kMaxChannels = Channels ? Channels : 8;
+        if constexpr (Channels != 0) {
+            channels = Channels;
+        }
+
+        std::array<uint32_t, kBlockFrames> first;
+        std::array<Fraction, kBlockFrames> fraction;
+        Coefficients<Coefficient, kTaps> coefficients;
+
+        for (uint32_t done = 0; done < frames; done += kBlockFrames) {
+            auto count = std::min(kBlockFrames, frames - done);
+            for (uint32_t i = 0; i < count; ++i) {
+                auto at = position + (done + i) * increment;
+                first[i] = static_cast<uint32_t>(at >> 32) - kBefore;
+                fraction[i] = toFraction(static_cast<uint32_t>(at));
+            }
+            kernel.compute(fraction.data(), count, coefficients);
+
+            auto* out = dst + static_cast<size_t>(done) * channels;
+            for (uint32_t i = 0; i < count; ++i) {
+                const auto* taps = src + static_cast<size_t>(first[i]) * channels;
+                std::array<Accumulator, kMaxChannels> sum{};
+                for (uint32_t tap = 0; tap < kTaps; ++tap) {
+                    for (uint16_t channel = 0; channel < channels; ++channel) {
+                        sum[channel] += coefficients[tap][i] * taps[tap * channels + channel];
+                    }
+                }
+                for (uint16_t channel = 0; channel < channels; ++channel) {
+                    out[i * channels + channel] += applyGain(sum[channel], gain);
+                }
+            }
+        }
+    }
+}
+
+uint64_t Interpolator::increment(int32_t cents) {
+    return static_cast<uint64_t>(std::llround(std::exp2(cents / 1200.0) * static_cast<double>(kUnity)));
+}
+
+void Interpolator::toWindow(const int16_t* src, size_t samples, Sample* dst) {
+    for (size_t i = 0; i < samples; ++i) {
+        dst[i] = static_cast<Sample>(src[i]);
+    }
+}
+
+template <uint16_t Channels>
+void Interpolator::mix(Interpolation mode, const Sample* src, uint16_t channels, uint64_t position,
+                       uint64_t increment, uint32_t frames, int32_t gain, int32_t* dst) {
+    switch (mode) {
+        case Interpolation::kLinear:
+            mixKernel<Linear, Channels>(Linear{}, src, channels, position, increment, frames, gain, dst);
+            break;
+        case Interpolation::kCubic:
+            mixKernel<Cubic, Channels>(Cubic{}, src, channels, position, increment, frames, gain, dst);
+            break;
+        case Interpolation::kSinc:
+            mixKernel<Sinc, Channels>(Sinc{kSincTables[sincTableFor(increment)]}, src, channels, position, increment,
+                                      frames, gain, dst);
+            break;
+    }
+}
+
+template void Interpolator::mix<0>(Interpolation, const Sample*, uint16_t, uint64_t, uint64_t, uint32_t, int32_t, int32_t*);
+template void Interpolator::mix<1>(Interpolation, const Sample*, uint16_t, uint64_t, uint64_t, uint32_t, int32_t, int32_t*);
+template void Interpolator::mix<2>(Interpolation, const Sample*, uint16_t, uint64_t, uint64_t, uint32_t, int32_t, int32_t*);
+template void Interpolator::mix<4>(Interpolation, const Sample*, uint16_t, uint64_t, uint64_t, uint32_t, int32_t, int32_t*);
+template void Interpolator::mix<6>(Interpolation, const Sample*, uint16_t, uint64_t, uint64_t, uint32_t, int32_t, int32_t*);
+template void Interpolator::mix<8>(Interpolation, const Sample*, uint16_t, uint64_t, uint64_t, uint32_t, int32_t, int32_t*);
+
+void Interpolator::mix(Interpolation mode, const Sample* src, uint16_t channels, uint64_t position,
+                       uint64_t increment, uint32_t frames, int32_t gain, int32_t* dst) {
+    switch (channels) {
+        case 1:
+            mix<1>(mode, src, channels, position, increment, frames, gain, dst);
+            break;
+        case 2:
+            mix<2>(mode, src, channels, position, increment, frames, gain, dst);
+            break;
+        default:
+            mix<0>(mode, src, channels, position, increment, frames, gain, dst);
+            break;
+    }
+}
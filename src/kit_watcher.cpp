@@ -0,0 +1,120 @@
+#include <array>
+#include <cerrno>
+#include <filesystem>
+#include <iostream>
+
+#include <poll.h>
+#include <sys/eventfd.h>
+#include <sys/inotify.h>
+#include <unistd.h>
+
+#include "rpi_sound/kit_watcher.hpp"
+
+namespace {
+    constexpr int kDebounceMs{150};
+    constexpr int kCollectIntervalMs{500};
+    constexpr uint32_t kWatchMask{IN_CLOSE_WRITE | IN_MOVED_TO | IN_MOVED_FROM |
+                                  IN_CREATE | IN_DELETE | IN_DELETE_SELF};
+}
+
+KitWatcher::~KitWatcher() {
+    stop();
+}
+
+bool KitWatcher::start() {
+    if (running_) {
+        return true;
+    }
+    if (!reload()) {
+        return false;
+    }
+
+    inotify_fd_ = inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+    wake_fd_ = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+    if (inotify_fd_ < 0 || wake_fd_ < 0) {
+        std::cout << "Kit watcher init failed!\r\n";
+        stop();
+        return false;
+    }
+    addWatches();
+
+    running_ = true;
+    thread_ = std::thread(&KitWatcher::run, this);
+    return true;
+}
+
+void KitWatcher::stop() {
+    if (running_.exchange(false) && wake_fd_ >= 0) {
+        uint64_t one = 1;
+        [[maybe_unused]] auto ret = write(wake_fd_, &one, sizeof(one));
+    }
+    if (thread_.joinable()) {
+        thread_.join();
+    }
+    if (inotify_fd_ >= 0) {
+        close(inotify_fd_);
+        inotify_fd_ = -1;
+    }
+    if (wake_fd_ >= 0) {
+        close(wake_fd_);
+        wake_fd_ = -1;
+    }
+}
+
+void KitWatcher::run() {
+    std::array<pollfd, 2> fds{pollfd{inotify_fd_, POLLIN, 0}, pollfd{wake_fd_, POLLIN, 0}};
+    alignas(inotify_event) std::array<char, 4096> events;
+    auto pending{false};
+
+    while (running_) {
+        // Keep waiting while events arrive so a file copied in several
+        // writes is only loaded once it is complete.
+        auto ret = poll(fds.data(), fds.size(), pending ? kDebounceMs : kCollectIntervalMs);
+        if (ret < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            std::cout << "Kit watcher poll failed!\r\n";
+            break;
+        }
+        if (fds[1].revents & POLLIN) {
+            break;
+        }
+        if (ret == 0) {
+            if (pending) {
+                reload();
+                addWatches();
+                pending = false;
+            }
+            engine_.collectRetired();
+            continue;
+        }
+        if (fds[0].revents & POLLIN) {
+            while (read(inotify_fd_, events.data(), events.size()) > 0) {
+                pending = true;
+            }
+        }
+    }
+}
+
+bool KitWatcher::reload() {
+    auto bank = SampleBank::load(kit_path_, engine_.sampleFormat(), engine_.bank().get(), options_);
+    if (!bank) {
+        return false;
+    }
+    std::cout << "Kit loaded: " << bank->instruments().size() << " instruments, "
+              << bank->residentBytes() / 1024 << " KiB\r\n";
+    return engine_.publishBank(std::move(bank));
+}
+
+void KitWatcher::addWatches() {
+    // Adding an existing watch again only updates its mask, so new
+    // instrument directories are picked up by simply re-adding all of them.
+    inotify_add_watch(inotify_fd_, kit_path_.c_str(), kWatchMask);
+    std::error_code ec;
+    for (const auto& entry : std::filesystem::directory_iterator(kit_path_, ec)) {
+        if (entry.is_directory(ec)) {
+            inotify_add_watch(inotify_fd_, entry.path().c_str(), kWatchMask);
+        }
+    }
+}
@@ -8,6 +8,28 @@ extern "C" {
 #include "tinyalsa/pcm.h"
 }
 
+Player::~Player() {
+    {
+        std::lock_guard lock(load_mutex_);
+        is_loader_running_ = false;
+    }
+    load_wake_.notify_one();
+    if (loader_.joinable()) {
+        loader_.join();
+    }
+
+    // Suspended coroutines would leak their frames, so they resume with
+    // false. playAsync() fails from here on, they can't queue another sound.
+    frame_bytes_ = 0;
+    auto pending = std::move(playing_);
+    pending.insert(pending.end(), queued_.begin(), queued_.end());
+    playing_.clear();
+    queued_.clear();
+    for (auto& entry : pending) {
+        entry.waiter.resume();
+    }
+}
+
 bool Player::play(const std::string_view& filePath) {
     if (!converter_->load(filePath)) {
         std::cout << "Loading failed!\r\n";
@@ -47,3 +69,150 @@ bool Player::play(const std::string_view& filePath) {
     
     return true;
 }
+
+bool Player::open(uint32_t card, uint32_t device, HWAudioFormat format) {
+    if (!driver_) {
+        driver_ = std::make_unique<TinyAlsaWrapper>(true);
+    }
+    if (!driver_->openDevice(card, device, true, format)) {
+        std::cout << "Failed to play on: Card " << card << " Device " << device << "\r\n";
+        return false;
+    }
+    hw_audio_format_ = format.audioFormat;
+    frame_bytes_ = hw_audio_format_.channels * hw_audio_format_.bitsPerSample / 8;
+    silence_.assign(static_cast<size_t>(format.periodSize) * frame_bytes_, 0);
+    if (!loader_.joinable()) {
+        is_loader_running_ = true;
+        loader_ = std::thread(&Player::load, this);
+    }
+    return true;
+}
+
+int Player::pollFd() const {
+    return driver_ ? driver_->getPollFd() : -1;
+}
+
+Player::PlayAwaiter Player::playAsync(const std::string_view& filePath) {
+    if (frame_bytes_ == 0) {
+        std::cout << "Loading failed!\r\n";
+        return PlayAwaiter{*this, {}, true};
+    }
+    return PlayAwaiter{*this, std::string{filePath}, false};
+}
+
+void Player::PlayAwaiter::await_suspend(std::coroutine_handle<> waiter) {
+    player_.queued_.push_back(Pending{nullptr, waiter, this, false, 0});
+    ++player_.loading_;
+    {
+        std::lock_guard lock(player_.load_mutex_);
+        player_.load_requests_.push_back(LoadRequest{std::move(path_), player_.hw_audio_format_});
+    }
+    player_.load_wake_.notify_one();
+}
+
+bool Player::isLoading() {
+    std::lock_guard lock(load_mutex_);
+    return loaded_.size() < loading_;
+}
+
+void Player::load() {
+    PCMConverter converter;
+    std::unique_lock lock(load_mutex_);
+    while (true) {
+        load_wake_.wait(lock, [this]() { return !is_loader_running_ || !load_requests_.empty(); });
+        if (!is_loader_running_) {
+            return;
+        }
+        auto request = std::move(load_requests_.front());
+        load_requests_.pop_front();
+
+        lock.unlock();
+        std::shared_ptr<PCMData> sound;
+        if (converter.load(request.path) && converter.convertToHwPCM(request.format)) {
+            sound = converter.getData();
+        } else {
+            std::cout << "Loading failed!\r\n";
+        }
+        lock.lock();
+        loaded_.push_back(std::move(sound));
+    }
+}
+
+void Player::collectLoads() {
+    std::deque<std::shared_ptr<PCMData>> loaded;
+    {
+        std::lock_guard lock(load_mutex_);
+        loaded.swap(loaded_);
+    }
+    // results come in request order, which is the order of queued_
+    std::vector<std::coroutine_handle<>> failed;
+    for (auto it = queued_.begin(); it != queued_.end() && !loaded.empty();) {
+        if (it->isLoaded) {
+            ++it;
+            continue;
+        }
+        it->sound = std::move(loaded.front());
+        it->isLoaded = true;
+        loaded.pop_front();
+        --loading_;
+        if (!it->sound) {
+            failed.push_back(it->waiter);
+            it = queued_.erase(it);
+        } else {
+            ++it;
+        }
+    }
+    for (auto waiter : failed) {
+        waiter.resume();
+    }
+}
+
+void Player::onWritable() {
+    auto queuedFrames = driver_->getQueuedFrames();
+    if (queuedFrames < 0) {
+        return;
+    }
+    collectLoads();
+    auto playedFrames = written_frames_ - std::min<uint64_t>(queuedFrames, written_frames_);
+    while (!playing_.empty() && playing_.front().endFrame <= playedFrames) {
+        auto finished = playing_.front();
+        playing_.pop_front();
+        finished.awaiter->is_played_ = true;
+        // may queue the next sound right away
+        finished.waiter.resume();
+    }
+
+    while (!queued_.empty() && queued_.front().isLoaded) {
+        auto& pending = queued_.front();
+        const auto& data = pending.sound->data;
+        auto frames = static_cast<uint32_t>((data.size() - position_) / frame_bytes_);
+        if (frames > 0) {
+            auto written = driver_->writeAvailable(data.data() + position_, frames);
+            if (written < 0) {
+                return;
+            }
+            position_ += static_cast<size_t>(written) * frame_bytes_;
+            written_frames_ += written;
+            if (static_cast<uint32_t>(written) < frames) {
+                // device buffer is full
+                return;
+            }
+        }
+        pending.endFrame = written_frames_;
+        playing_.push_back(pending);
+        queued_.pop_front();
+        position_ = 0;
+    }
+    writeSilence();
+}
+
+void Player::writeSilence() {
+    auto frames = static_cast<uint32_t>(silence_.size() / frame_bytes_);
+    int32_t written;
+    do {
+        written = driver_->writeAvailable(silence_.data(), frames);
+        if (written > 0) {
+            written_frames_ += written;
+        }
+    } while (written > 0 && static_cast<uint32_t>(written) == frames);
+}
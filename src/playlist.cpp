@@ -0,0 +1,316 @@
+#include <algorithm>
+#include <cmath>
+#include <iostream>
+#include <limits>
+#include <numbers>
+#include <type_traits>
+
+#include "rpi_sound/pcm_converter.hpp"
+#include "rpi_sound/playlist.hpp"
+#include "rpi_sound/tiny_alsa_wrapper.hpp"
+
+namespace {
+    bool canCrossfade(const AudioFormat& format) {
+        if (format.isFloat) {
+            return format.bitsPerSample == 32;
+        }
+        return format.bitsPerSample == 16 || format.bitsPerSample == 32;
+    }
+
+    template <typename Sample>
+    inline Sample toSample(double value) {
+        if constexpr (std::is_same_v<Sample, float>) {
+            return static_cast<float>(value);
+        } else {
+            constexpr double kMin = std::numeric_limits<Sample>::min();
+            constexpr double kMax = std::numeric_limits<Sample>::max();
+            return static_cast<Sample>(std::llround(std::clamp(value, kMin, kMax)));
+        }
+    }
+
+    // Frame offset + i of a fade over length frames: from * cos + to * sin,
+    // so the summed power stays constant for uncorrelated tracks.
+    template <typename Sample>
+    void fadeFrames(const uint8_t* from, const uint8_t* to, uint16_t channels, uint32_t offset,
+                    uint32_t length, uint32_t frames, uint8_t* out) {
+        const auto* a = reinterpret_cast<const Sample*>(from);
+        const auto* b = reinterpret_cast<const Sample*>(to);
+        auto* dst = reinterpret_cast<Sample*>(out);
+        for (uint32_t frame = 0; frame < frames; ++frame) {
+            auto angle = (offset + frame + 0.5) / length * (std::numbers::pi / 2);
+            auto fadeOut = std::cos(angle);
+            auto fadeIn = std::sin(angle);
+            for (uint16_t channel = 0; channel < channels; ++channel) {
+                auto i = static_cast<size_t>(frame) * channels + channel;
+                dst[i] = toSample<Sample>(a[i] * fadeOut + b[i] * fadeIn);
+            }
+        }
+    }
+
+    void fade(const AudioFormat& format, const uint8_t* from, const uint8_t* to, uint32_t offset,
+              uint32_t length, uint32_t frames, uint8_t* out) {
+        if (format.isFloat) {
+            fadeFrames<float>(from, to, format.channels, offset, length, frames, out);
+        } else if (format.bitsPerSample == 32) {
+            fadeFrames<int32_t>(from, to, format.channels, offset, length, frames, out);
+        } else {
+            fadeFrames<int16_t>(from, to, format.channels, offset, length, frames, out);
+        }
+    }
+}
+
+Playlist::Playlist() = default;
+
+Playlist::Playlist(std::unique_ptr<IAudioDriver> driver) :
+    driver_{std::move(driver)} {}
+
+Playlist::~Playlist() {
+    stopLoader();
+}
+
+bool Playlist::open(uint32_t card, uint32_t device, HWAudioFormat format) {
+    // the loader converts to format_, so it can't run while that changes
+    stopLoader();
+    if (!driver_) {
+        driver_ = std::make_unique<TinyAlsaWrapper>(true);
+    }
+    driver_->closeDevice();
+    period_.clear();
+    rendered_frames_ = 0;
+    written_frames_ = 0;
+    end_frame_ = 0;
+    if (!driver_->openDevice(card, device, true, format)) {
+        std::cout << "Failed to play on: Card " << card << " Device " << device << "\r\n";
+        return false;
+    }
+    format_ = format.audioFormat;
+    frame_bytes_ = format_.channels * format_.bitsPerSample / 8;
+    period_.assign(static_cast<size_t>(format.periodSize) * frame_bytes_, 0);
+    period_position_ = period_.size();
+    updateFade();
+
+    is_running_ = true;
+    loader_ = std::thread(&Playlist::load, this);
+    return true;
+}
+
+void Playlist::stop() {
+    {
+        std::lock_guard lock(mutex_);
+        paths_.clear();
+        ready_.clear();
+        // a track the loader is working on is dropped when it's done
+        dropped_before_ = appended_;
+    }
+    current_ = Track{};
+    next_ = Track{};
+    starved_before_ = 0;
+    // what's left of the period is never written
+    period_position_ = period_.size();
+    rendered_frames_ = written_frames_;
+    end_frame_ = rendered_frames_;
+}
+
+void Playlist::stopLoader() {
+    stop();
+    {
+        std::lock_guard lock(mutex_);
+        is_running_ = false;
+        retired_.clear();
+    }
+    wake_.notify_one();
+    if (loader_.joinable()) {
+        loader_.join();
+    }
+}
+
+bool Playlist::append(const std::string_view& filePath) {
+    {
+        std::lock_guard lock(mutex_);
+        if (!is_running_) {
+            return false;
+        }
+        paths_.push_back(Queued{.path = std::string{filePath}, .sequence = appended_++});
+    }
+    is_idle_ = false;
+    wake_.notify_one();
+    return true;
+}
+
+void Playlist::setCrossfade(std::chrono::milliseconds time) {
+    crossfade_ = time;
+    updateFade();
+}
+
+void Playlist::updateFade() {
+    fade_frames_ = 0;
+    if (crossfade_.count() <= 0 || frame_bytes_ == 0) {
+        return;
+    }
+    if (!canCrossfade(format_)) {
+        std::cout << "Crossfade not supported for " << format_.bitsPerSample << "-bit samples\r\n";
+        return;
+    }
+    fade_frames_ = static_cast<uint32_t>(static_cast<uint64_t>(crossfade_.count()) * format_.sampleRate / 1000);
+}
+
+size_t Playlist::prefetched() {
+    std::lock_guard lock(mutex_);
+    return ready_.size();
+}
+
+bool Playlist::hasQueued() {
+    std::lock_guard lock(mutex_);
+    return !paths_.empty() || !ready_.empty() || is_loading_;
+}
+
+int Playlist::pollFd() const {
+    return driver_ ? driver_->getPollFd() : -1;
+}
+
+void Playlist::onWritable() {
+    if (period_.empty()) {
+        return;
+    }
+    auto queuedFrames = driver_->getQueuedFrames();
+    if (queuedFrames < 0) {
+        return;
+    }
+    auto playedFrames = written_frames_ - std::min<uint64_t>(queuedFrames, written_frames_);
+
+    const auto periodFrames = static_cast<uint32_t>(period_.size() / frame_bytes_);
+    while (true) {
+        if (period_position_ == period_.size()) {
+            render(period_.data(), periodFrames);
+            period_position_ = 0;
+        }
+        auto frames = static_cast<uint32_t>((period_.size() - period_position_) / frame_bytes_);
+        auto written = driver_->writeAvailable(period_.data() + period_position_, frames);
+        if (written <= 0) {
+            break;
+        }
+        period_position_ += static_cast<size_t>(written) * frame_bytes_;
+        written_frames_ += written;
+        if (static_cast<uint32_t>(written) < frames) {
+            // device buffer is full
+            break;
+        }
+    }
+    is_idle_ = !current_.sound && playedFrames >= end_frame_ && !hasQueued();
+}
+
+void Playlist::render(uint8_t* out, uint32_t frames) {
+    while (frames > 0) {
+        if (!current_.sound && !takeTrack(current_)) {
+            std::fill_n(out, static_cast<size_t>(frames) * frame_bytes_, 0);
+            rendered_frames_ += frames;
+            return;
+        }
+
+        auto remaining = current_.frames - current_.position;
+        if (!next_.sound && remaining <= fade_frames_ && takeTrack(next_)) {
+            // shorter if the next track was loaded late or is short itself
+            fade_start_ = current_.frames - std::min({fade_frames_, remaining, next_.frames});
+        }
+
+        const auto* data = current_.sound->data.data() + static_cast<size_t>(current_.position) * frame_bytes_;
+        uint32_t count;
+        if (next_.sound && current_.position >= fade_start_) {
+            count = std::min(frames, remaining);
+            fade(format_, data, next_.sound->data.data() + static_cast<size_t>(next_.position) * frame_bytes_,
+                 current_.position - fade_start_, current_.frames - fade_start_, count, out);
+            next_.position += count;
+        } else {
+            auto end = current_.frames;
+            if (next_.sound) {
+                end = fade_start_;
+            } else if (remaining > fade_frames_) {
+                // stop where the next track should fade in
+                end = current_.frames - fade_frames_;
+            }
+            count = std::min(frames, end - current_.position);
+            std::copy_n(data, static_cast<size_t>(count) * frame_bytes_, out);
+        }
+        current_.position += count;
+        out += static_cast<size_t>(count) * frame_bytes_;
+        frames -= count;
+        rendered_frames_ += count;
+
+        if (current_.position == current_.frames) {
+            retire(current_);
+            current_ = std::move(next_);
+            next_ = Track{};
+            // gapless: the next track continues in the same period
+            if (!current_.sound && !takeTrack(current_)) {
+                end_frame_ = rendered_frames_;
+                // an underrun if one of these starts after the gap
+                starved_before_ = appended_;
+            }
+        }
+    }
+}
+
+bool Playlist::takeTrack(Track& track) {
+    {
+        std::lock_guard lock(mutex_);
+        if (ready_.empty()) {
+            return false;
+        }
+        track = std::move(ready_.front());
+        ready_.pop_front();
+    }
+    if (track.sequence < starved_before_) {
+        ++underruns_;
+        starved_before_ = 0;
+    }
+    wake_.notify_one();
+    return true;
+}
+
+void Playlist::retire(Track& track) {
+    {
+        std::lock_guard lock(mutex_);
+        retired_.push_back(std::move(track.sound));
+    }
+    wake_.notify_one();
+    track = Track{};
+}
+
+void Playlist::load() {
+    PCMConverter converter;
+    std::vector<std::shared_ptr<PCMData>> retired;
+    std::unique_lock lock(mutex_);
+    while (is_running_) {
+        retired.swap(retired_);
+        auto hasWork = !paths_.empty() && ready_.size() < kPrefetchTracks;
+        if (retired.empty() && !hasWork) {
+            wake_.wait(lock);
+            continue;
+        }
+        Queued queued;
+        if (hasWork) {
+            queued = std::move(paths_.front());
+            paths_.pop_front();
+            is_loading_ = true;
+        }
+
+        // The file I/O and freeing played tracks happen without the lock.
+        lock.unlock();
+        retired.clear();
+        Track track;
+        if (!queued.path.empty()) {
+            if (converter.load(queued.path) && converter.convertToHwPCM(format_)) {
+                track.sound = converter.getData();
+                track.frames = static_cast<uint32_t>(track.sound->data.size() / frame_bytes_);
+                track.sequence = queued.sequence;
+            } else {
+                std::cout << "Loading failed: " << queued.path << "\r\n";
+            }
+        }
+        lock.lock();
+        is_loading_ = false;
+        if (track.sound && queued.sequence >= dropped_before_) {
+            ready_.push_back(std::move(track));
+        }
+    }
+}
@@ -0,0 +1,152 @@
+#include <chrono>
+#include <cstring>
+#include <iostream>
+
+#include <pthread.h>
+#include <sched.h>
+
+#include "rpi_sound/recorder.hpp"
+
+namespace {
+    constexpr size_t kWriteChunkBytes{256 * 1024};
+    constexpr auto kWriterIdle{std::chrono::milliseconds(5)};
+    constexpr auto kErrorBackoff{std::chrono::milliseconds(1)};
+    constexpr int kCapturePriority{70};
+}
+
+Recorder::~Recorder() {
+    stop();
+}
+
+bool Recorder::start(uint32_t card, uint32_t device, HWAudioFormat format, const std::string& path,
+                     const RecorderOptions& options) {
+    if (running_) {
+        return false;
+    }
+    if (!driver_->openDevice(card, device, false, format)) {
+        std::cout << "Failed to open capture: Card " << card << " Device " << device << "\r\n";
+        return false;
+    }
+
+    // AudioFormat maps 24 bits to S24_LE, i.e. a 4 byte container
+    const auto bits = format.audioFormat.bitsPerSample;
+    is_packed_24_ = bits == 24;
+    capture_frame_bytes_ = format.audioFormat.channels * (is_packed_24_ ? 4 : bits / 8);
+    if (capture_frame_bytes_ == 0 || !writer_.open(path, format.audioFormat, options.file)) {
+        driver_->closeDevice();
+        return false;
+    }
+
+    format_ = format;
+    ring_ = std::make_unique<SpscRing>(options.ringBytes / capture_frame_bytes_ * capture_frame_bytes_);
+    drop_buffer_.resize(static_cast<size_t>(format.periodSize) * capture_frame_bytes_);
+    pack_buffer_.resize(kWriteChunkBytes);
+    captured_frames_ = 0;
+    written_frames_ = 0;
+    dropped_frames_ = 0;
+    capture_errors_ = 0;
+    ring_high_water_ = 0;
+    is_write_failed_ = false;
+
+    running_ = true;
+    is_capture_done_ = false;
+    capture_thread_ = std::thread(&Recorder::captureLoop, this);
+    writer_thread_ = std::thread(&Recorder::writeLoop, this);
+    return true;
+}
+
+bool Recorder::stop() {
+    if (!running_.exchange(false)) {
+        return false;
+    }
+    capture_thread_.join();
+    driver_->closeDevice();
+    is_capture_done_ = true;
+    writer_thread_.join();
+    return writer_.close() && !is_write_failed_;
+}
+
+Recorder::Stats Recorder::stats() const {
+    return Stats{
+        .capturedFrames = captured_frames_.load(std::memory_order_relaxed),
+        .writtenFrames = written_frames_.load(std::memory_order_relaxed),
+        .droppedFrames = dropped_frames_.load(std::memory_order_relaxed),
+        .captureErrors = capture_errors_.load(std::memory_order_relaxed),
+        .ringHighWater = ring_high_water_.load(std::memory_order_relaxed),
+        .ringCapacity = ring_ ? ring_->capacity() : 0
+    };
+}
+
+void Recorder::captureLoop() {
+    // best effort, needs CAP_SYS_NICE or an rtprio limit
+    sched_param param{};
+    param.sched_priority = kCapturePriority;
+    pthread_setschedparam(pthread_self(), SCHED_FIFO, &param);
+
+    while (running_.load(std::memory_order_acquire)) {
+        auto space = ring_->writable();
+        auto frames = std::min<size_t>(space.size() / capture_frame_bytes_, format_.periodSize);
+
+        if (frames == 0) {
+            // Keep reading so the device does not overrun, the data is lost either way.
+            auto readFrames = driver_->readData(drop_buffer_.data(), format_.periodSize);
+            if (readFrames > 0) {
+                dropped_frames_.fetch_add(readFrames, std::memory_order_relaxed);
+            }
+            continue;
+        }
+
+        auto readFrames = driver_->readData(space.data(), static_cast<uint32_t>(frames));
+        if (readFrames < 0) {
+            capture_errors_.fetch_add(1, std::memory_order_relaxed);
+            std::this_thread::sleep_for(kErrorBackoff);
+            continue;
+        }
+        ring_->commitWrite(static_cast<size_t>(readFrames) * capture_frame_bytes_);
+        captured_frames_.fetch_add(readFrames, std::memory_order_relaxed);
+
+        auto used = ring_->size();
+        if (used > ring_high_water_.load(std::memory_order_relaxed)) {
+            ring_high_water_.store(used, std::memory_order_relaxed);
+        }
+    }
+}
+
+void Recorder::writeLoop() {
+    const auto chunkBytes = kWriteChunkBytes / capture_frame_bytes_ * capture_frame_bytes_;
+    while (true) {
+        auto data = ring_->readable();
+        if (data.empty()) {
+            if (is_capture_done_.load(std::memory_order_acquire) && ring_->readable().empty()) {
+                break;
+            }
+            std::this_thread::sleep_for(kWriterIdle);
+            continue;
+        }
+
+        auto bytes = std::min(data.size(), chunkBytes);
+        writeChunk(data.data(), bytes);
+        ring_->commitRead(bytes);
+        written_frames_.fetch_add(bytes / capture_frame_bytes_, std::memory_order_relaxed);
+    }
+}
+
+void Recorder::writeChunk(const uint8_t* data, size_t bytes) {
+    if (is_write_failed_) {
+        return;
+    }
+    if (is_packed_24_) {
+        // S24_LE keeps the sample in the low 3 bytes of each 4
+        auto* out = pack_buffer_.data();
+        for (size_t i = 0; i < bytes; i += 4) {
+            std::memcpy(out, data + i, 3);
+            out += 3;
+        }
+        data = pack_buffer_.data();
+        bytes = static_cast<size_t>(out - pack_buffer_.data());
+    }
+    if (!writer_.write(data, bytes)) {
+        std::cout << "Recording write failed, discarding further data\r\n";
+        is_write_failed_ = true;
+    }
+}
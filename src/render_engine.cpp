@@ -0,0 +1,545 @@
+#include <algorithm>
+#include <chrono>
+#include <iostream>
+#include <limits>
+#include <type_traits>
+
+#include "rpi_sound/render_engine.hpp"
+#include "rpi_sound/render_pipeline.hpp"
+
+namespace {
+    constexpr uint32_t kMaxPitchRatio{1u << (RenderEngine::kMaxPitchCents / 1200)};
+
+    std::chrono::nanoseconds periodDuration(const HWAudioFormat& format) {
+        return std::chrono::nanoseconds{uint64_t{1000000000} * format.periodSize /
+                                        std::max(format.audioFormat.sampleRate, 1u)};
+    }
+}
+
+RenderEngine::RenderEngine(std::unique_ptr<IAudioDeviceManager> device, const HWAudioFormat& format) :
+    device_{std::move(device)},
+    format_{format},
+    load_meter_{format},
+    frame_clock_{format.audioFormat.sampleRate},
+    trigger_latency_{format.periodSize * (format.periodCount + 1)},
+    period_(static_cast<size_t>(format.periodSize) * format.audioFormat.channels * (format.audioFormat.bitsPerSample / 8)),
+    group_mix_(static_cast<size_t>(kMaxVoiceGroups) * format.periodSize * format.audioFormat.channels),
+    workers_{std::make_unique<WorkerPool>(0, periodDuration(format))},
+    scratch_(1, makeScratch()),
+    decode_cache_frames_{AdpcmCodec::framesPerBlock(AdpcmCodec::kBlockBytesPerChannel * format.audioFormat.channels,
+                                                    format.audioFormat.channels)},
+    decode_cache_(static_cast<size_t>(kMaxVoices) * decode_cache_frames_ * format.audioFormat.channels),
+    pitch_history_(static_cast<size_t>(kMaxVoices) * Interpolator::kMaxTaps * format.audioFormat.channels) {
+    selectLoops();
+}
+
+RenderEngine::~RenderEngine() {
+    stop();
+}
+
+bool RenderEngine::start() {
+    if (!sum_groups_) {
+        std::cout << "Unsupported output format: " << format_.audioFormat.bitsPerSample
+                  << (format_.audioFormat.isFloat ? " bits float\r\n" : " bits\r\n");
+        return false;
+    }
+    if (running_.exchange(true)) {
+        return true;
+    }
+    if (streamer_ && !streamer_->start()) {
+        running_ = false;
+        return false;
+    }
+    thread_ = std::thread(&RenderEngine::run, this);
+    return true;
+}
+
+void RenderEngine::stop() {
+    if (running_.exchange(false) && thread_.joinable()) {
+        thread_.join();
+    }
+    if (streamer_) {
+        streamer_->stop();
+    }
+}
+
+bool RenderEngine::enableStreaming(uint32_t bufferMs) {
+    if (running_) {
+        return false;
+    }
+    auto bufferFrames = static_cast<uint32_t>(static_cast<uint64_t>(format_.audioFormat.sampleRate) * bufferMs / 1000);
+    streamer_ = std::make_unique<DiskStreamer>(sampleFormat(),
+                                               std::max(bufferFrames, format_.periodSize * 2),
+                                               kMaxVoices);
+    return streamer_->start();
+}
+
+uint64_t RenderEngine::streamUnderruns() const {
+    return streamer_ ? streamer_->underruns() : 0;
+}
+
+uint64_t RenderEngine::streamOpenFailures() const {
+    return streamer_ ? streamer_->openFailures() : 0;
+}
+
+bool RenderEngine::setWorkerThreads(uint32_t threads, int32_t renderCore) {
+    const auto cores = std::max(std::thread::hardware_concurrency(), 1u);
+    if (running_ || renderCore >= static_cast<int32_t>(cores) || renderCore < kUnpinned) {
+        return false;
+    }
+    // a spinning worker sharing a core with the render thread only slows it down
+    threads = std::min(threads, cores - 1);
+    render_core_ = renderCore == kLastCore ? static_cast<int32_t>(cores) - 1 : renderCore;
+    auto callerCore = render_core_ == kUnpinned ? WorkerPool::kUnpinned : render_core_;
+    workers_ = std::make_unique<WorkerPool>(threads, periodDuration(format_), callerCore);
+    scratch_.resize(threads + 1, makeScratch());
+    return true;
+}
+
+bool RenderEngine::publishBank(std::shared_ptr<const SampleBank> bank) {
+    if (!bank || bank->format() != sampleFormat()) {
+        std::cout << "Sample bank does not match the output format\r\n";
+        return false;
+    }
+
+    std::lock_guard<std::mutex> lock(bank_mutex_);
+    auto slot = std::make_unique<BankSlot>(BankSlot{next_generation_++, std::move(bank)});
+    live_bank_.store(slot.get(), std::memory_order_release);
+    if (current_bank_) {
+        retired_banks_.push_back(std::move(current_bank_));
+    }
+    current_bank_ = std::move(slot);
+    return true;
+}
+
+std::shared_ptr<const SampleBank> RenderEngine::bank() const {
+    std::lock_guard<std::mutex> lock(bank_mutex_);
+    return current_bank_ ? current_bank_->bank : nullptr;
+}
+
+size_t RenderEngine::collectRetired() {
+    std::lock_guard<std::mutex> lock(bank_mutex_);
+    auto oldestInUse = oldest_generation_in_use_.load(std::memory_order_acquire);
+    std::erase_if(retired_banks_, [oldestInUse](const auto& slot) {
+        return slot->generation < oldestInUse;
+    });
+    return retired_banks_.size();
+}
+
+bool RenderEngine::trigger(std::string_view instrument, uint8_t velocity, int16_t pitch, int64_t time) {
+    return trigger(SampleBank::instrumentId(instrument), velocity, pitch, time);
+}
+
+bool RenderEngine::trigger(uint32_t instrumentId, uint8_t velocity, int16_t pitch, int64_t time) {
+    return triggers_.push(Trigger{instrumentId, velocity, pitch, time});
+}
+
+const std::vector<uint8_t>& RenderEngine::renderPeriod() {
+    load_meter_.beginPeriod();
+    const auto* slot = live_bank_.load(std::memory_order_acquire);
+
+    // Triggers wait until the period that holds their frame.
+    updateClock();
+    const auto periodEnd = static_cast<int64_t>(render_position_ + format_.periodSize);
+    for (size_t i = 0; i < pending_count_;) {
+        if (pending_[i].frame < periodEnd) {
+            if (slot) {
+                startVoice(pending_[i].trigger, *slot,
+                           static_cast<uint32_t>(pending_[i].frame - static_cast<int64_t>(render_position_)));
+            }
+            pending_[i] = pending_[--pending_count_];
+        } else {
+            ++i;
+        }
+    }
+    Trigger trigger;
+    while (triggers_.pop(trigger)) {
+        auto frame = scheduledFrame(trigger);
+        if (frame >= periodEnd && pending_count_ < pending_.size()) {
+            pending_[pending_count_++] = PendingTrigger{trigger, frame};
+        } else if (slot) {
+            auto delay = std::min(frame - static_cast<int64_t>(render_position_), static_cast<int64_t>(format_.periodSize) - 1);
+            startVoice(trigger, *slot, static_cast<uint32_t>(delay));
+        }
+    }
+    load_meter_.mark(DspLoadMeter::kTriggers);
+
+    // Groups follow the order of voices_, so they only depend on which
+    // voices are active and not on the threads that render them.
+    active_count_ = 0;
+    for (uint32_t index = 0; index < kMaxVoices; ++index) {
+        if (voices_[index].active) {
+            active_voices_[active_count_++] = static_cast<uint8_t>(index);
+        }
+    }
+    group_count_ = (active_count_ + kVoicesPerGroup - 1) / kVoicesPerGroup;
+    period_interpolation_ = interpolation_.load(std::memory_order_relaxed);
+    workers_->run(group_count_, [](void* engine, uint32_t group, uint32_t worker) {
+        auto* self = static_cast<RenderEngine*>(engine);
+        (self->*self->render_group_)(group, worker);
+    }, this);
+    load_meter_.mark(DspLoadMeter::kVoices);
+
+    // no effects yet, the stage is reported as zero
+    load_meter_.mark(DspLoadMeter::kEffects);
+
+    workers_->run(kSumChunks, [](void* engine, uint32_t chunk, uint32_t worker) {
+        auto* self = static_cast<RenderEngine*>(engine);
+        (self->*self->sum_groups_)(chunk, worker);
+    }, this);
+    load_meter_.mark(DspLoadMeter::kConversion);
+
+    // Publish the oldest bank generation this thread may still dereference.
+    // Everything older than that can be freed by collectRetired().
+    auto oldest = slot ? slot->generation : std::numeric_limits<uint64_t>::max();
+    for (const auto& voice : voices_) {
+        if (voice.active) {
+            oldest = std::min(oldest, voice.generation);
+        }
+    }
+    if (oldest != std::numeric_limits<uint64_t>::max()) {
+        oldest_generation_in_use_.store(oldest, std::memory_order_release);
+    }
+
+    render_position_ += format_.periodSize;
+    // voice bookkeeping, so kDriverWrite is only the time in the device
+    load_meter_.mark(DspLoadMeter::kVoices);
+    return period_;
+}
+
+void RenderEngine::run() {
+    if (workers_->threads() > 0 && render_core_ != kUnpinned) {
+        WorkerPool::pinToCore(static_cast<uint32_t>(render_core_));
+    }
+    // Without a usable device, e.g. a lost card and no fallback, the write
+    // fails at once. Waiting a period keeps the thread from spinning and
+    // rendering stays in step with time, so triggers of the outage do not
+    // pile up and burst out once a card is back.
+    const auto backoff = periodDuration(format_);
+    while (running_.load(std::memory_order_acquire)) {
+        if (!device_->writeData(renderPeriod())) {
+            dropped_periods_.fetch_add(1, std::memory_order_relaxed);
+            std::this_thread::sleep_for(backoff);
+        }
+        load_meter_.mark(DspLoadMeter::kDriverWrite);
+    }
+}
+
+void RenderEngine::updateClock() {
+    // Everything rendered so far has been written, what the buffer cannot
+    // take yet is still queued in front of the DAC.
+    uint32_t available{0};
+    timespec time{};
+    if (device_->getTimestamp(available, time)) {
+        auto queued = static_cast<int64_t>(format_.periodSize) * format_.periodCount - available;
+        frame_clock_.addSample(FrameClock::toNanoseconds(time), static_cast<int64_t>(render_position_) - queued);
+    }
+}
+
+int64_t RenderEngine::scheduledFrame(const Trigger& trigger) {
+    const auto now = static_cast<int64_t>(render_position_);
+    if (trigger.time == 0 || !frame_clock_.isLocked()) {
+        return now;
+    }
+    auto frame = frame_clock_.frameAt(trigger.time) + trigger_latency_;
+    if (frame < now) {
+        late_triggers_.fetch_add(1, std::memory_order_relaxed);
+        return now;
+    }
+    return frame;
+}
+
+void RenderEngine::startVoice(const Trigger& trigger, const BankSlot& slot, uint32_t delay) {
+    if (trigger.velocity == 0) {
+        return;
+    }
+    const auto* instrument = slot.bank->findInstrument(trigger.instrument);
+    if (!instrument || instrument->samples.empty()) {
+        return;
+    }
+    const auto& sample = instrument->samples[nextRandom() % instrument->samples.size()];
+    if (sample.adpcm && sample.adpcm->framesPerBlock > decode_cache_frames_) {
+        return;
+    }
+
+    // Use a free voice, otherwise steal the one that has played the longest.
+    auto* voice = &voices_[0];
+    for (auto& candidate : voices_) {
+        if (!candidate.active) {
+            voice = &candidate;
+            break;
+        }
+        if (candidate.position > voice->position) {
+            voice = &candidate;
+        }
+    }
+
+    auto index = static_cast<uint32_t>(voice - voices_.data());
+    if (voice->active && voice->streamed) {
+        streamer_->close(index);
+    }
+
+    // Without a streamer, or when its request queue is full, only the head
+    // plays. The latter counts in streamOpenFailures().
+    auto isStreamed = sample.residentFrames < sample.frameCount &&
+                      streamer_ && streamer_->open(index, sample);
+    auto cents = std::clamp(instrument->tuning + trigger.pitch, -kMaxPitchCents, kMaxPitchCents);
+    auto increment = cents == 0 ? Interpolator::kUnity : Interpolator::increment(cents);
+    if (increment != Interpolator::kUnity) {
+        const auto historySize = Interpolator::kMaxTaps * format_.audioFormat.channels;
+        std::fill_n(pitch_history_.begin() + index * historySize, historySize, Interpolator::Sample{0});
+    }
+
+    *voice = Voice{
+        .data = sample.pcm ? reinterpret_cast<const int16_t*>(sample.pcm->data.data()) : nullptr,
+        .adpcm = sample.adpcm.get(),
+        .decodedBlock = UINT32_MAX,
+        .frameCount = isStreamed ? sample.frameCount : sample.residentFrames,
+        .residentFrames = sample.residentFrames,
+        .position = 0,
+        .delay = delay,
+        .phase = 0,
+        .increment = increment,
+        .gain = static_cast<int32_t>(std::min<uint8_t>(trigger.velocity, 127)) * 32767 / 127,
+        .generation = slot.generation,
+        .active = true,
+        .streamed = isStreamed
+    };
+}
+
+template <uint16_t Channels>
+void RenderEngine::renderGroup(uint32_t group, uint32_t worker) {
+    const auto samples = static_cast<size_t>(format_.periodSize) * channels<Channels>();
+    auto* dst = group_mix_.data() + group * samples;
+    std::fill_n(dst, samples, 0);
+    auto end = std::min(active_count_, (group + 1) * kVoicesPerGroup);
+    for (auto i = group * kVoicesPerGroup; i < end; ++i) {
+        auto index = active_voices_[i];
+        renderVoice<Channels>(index, voices_[index], format_.periodSize, scratch_[worker], dst);
+    }
+}
+
+template <uint16_t Channels>
+void RenderEngine::renderVoice(uint32_t index, Voice& voice, uint32_t frames, Scratch& scratch, int32_t* dst) {
+    if (voice.delay > 0) {
+        auto delay = std::min(voice.delay, frames);
+        voice.delay -= delay;
+        frames -= delay;
+        dst += static_cast<size_t>(delay) * channels<Channels>();
+        if (frames == 0) {
+            return;
+        }
+    }
+    if (voice.increment != Interpolator::kUnity) {
+        renderPitched<Channels>(index, voice, frames, scratch, dst);
+        return;
+    }
+    const auto channels = this->channels<Channels>();
+    auto count = std::min(frames, voice.frameCount - voice.position);
+
+    if (voice.adpcm) {
+        renderCompressed<Channels>(index, voice, count, dst);
+    } else if (voice.position < voice.residentFrames) {
+        auto resident = std::min(count, voice.residentFrames - voice.position);
+        RenderPipeline::mix<Channels>(voice.data + static_cast<size_t>(voice.position) * channels, channels, resident,
+                                      voice.gain, dst);
+        voice.position += resident;
+        count -= resident;
+        dst += resident * channels;
+    }
+
+    if (count > 0 && voice.streamed) {
+        auto got = streamer_->read(index, scratch.stream.data(), count);
+        RenderPipeline::mix<Channels>(reinterpret_cast<const int16_t*>(scratch.stream.data()), channels, got, voice.gain,
+                                      dst);
+        if (got < count) {
+            streamer_->drop(index, count - got);
+        }
+        voice.position += count;
+    }
+
+    if (voice.position >= voice.frameCount) {
+        voice.active = false;
+        if (voice.streamed) {
+            streamer_->close(index);
+        }
+    }
+}
+
+template <uint16_t Channels>
+void RenderEngine::renderCompressed(uint32_t index, Voice& voice, uint32_t frames, int32_t* dst) {
+    // Only the blocks this period touches are decoded. A block that spans
+    // two periods stays in the per-voice cache and is decoded once.
+    const auto channels = this->channels<Channels>();
+    const auto framesPerBlock = voice.adpcm->framesPerBlock;
+    auto* cache = decode_cache_.data() + static_cast<size_t>(index) * decode_cache_frames_ * channels;
+
+    while (frames > 0) {
+        auto block = voice.position / framesPerBlock;
+        auto offset = voice.position % framesPerBlock;
+        if (voice.decodedBlock != block) {
+            AdpcmCodec::decodeBlock(*voice.adpcm, block, cache);
+            voice.decodedBlock = block;
+        }
+        auto count = std::min(frames, framesPerBlock - offset);
+        RenderPipeline::mix<Channels>(cache + static_cast<size_t>(offset) * channels, channels, count, voice.gain, dst);
+        dst += count * channels;
+        voice.position += count;
+        frames -= count;
+    }
+}
+
+template <uint16_t Channels>
+void RenderEngine::renderPitched(uint32_t index, Voice& voice, uint32_t frames, Scratch& scratch, int32_t* dst) {
+    // The window holds the last kMaxTaps frames of the previous period
+    // followed by the source frames this period reads up to its lookahead.
+    const auto channels = this->channels<Channels>();
+    const auto historySize = Interpolator::kMaxTaps * channels;
+    auto* history = pitch_history_.data() + static_cast<size_t>(index) * historySize;
+    auto* window = scratch.pitchWindow.data();
+
+    const auto end = static_cast<uint64_t>(voice.frameCount) << 32;
+    auto count = static_cast<uint32_t>(std::min<uint64_t>(frames, (end - voice.phase + voice.increment - 1) / voice.increment));
+    auto last = ((voice.phase + (count - 1) * voice.increment) >> 32) + Interpolator::kLookahead;
+    auto fetch = static_cast<uint32_t>(last + 1 - std::min<uint64_t>(last + 1, voice.position));
+    auto windowStart = (static_cast<uint64_t>(voice.position) - Interpolator::kMaxTaps) << 32;
+
+    std::copy_n(history, historySize, window);
+    fetchFrames<Channels>(index, voice, fetch, scratch.pitchFetch.data());
+    Interpolator::toWindow(scratch.pitchFetch.data(), static_cast<size_t>(fetch) * channels, window + historySize);
+    Interpolator::mix<Channels>(period_interpolation_, window, channels, voice.phase - windowStart, voice.increment,
+                                count, voice.gain, dst);
+    std::copy_n(window + static_cast<size_t>(fetch) * channels, historySize, history);
+
+    voice.phase += count * voice.increment;
+    if (voice.phase >= end) {
+        voice.active = false;
+        if (voice.streamed) {
+            streamer_->close(index);
+        }
+    }
+}
+
+template <uint16_t Channels>
+void RenderEngine::fetchFrames(uint32_t index, Voice& voice, uint32_t frames, int16_t* dst) {
+    const auto channels = this->channels<Channels>();
+    auto available = std::min(frames, voice.frameCount - std::min(voice.position, voice.frameCount));
+    // the lookahead reads a few frames past the end of the sample
+    std::fill(dst + static_cast<size_t>(available) * channels, dst + static_cast<size_t>(frames) * channels, 0);
+    auto silent = frames - available;
+
+    while (available > 0) {
+        auto count = available;
+        if (voice.adpcm) {
+            const auto framesPerBlock = voice.adpcm->framesPerBlock;
+            auto* cache = decode_cache_.data() + static_cast<size_t>(index) * decode_cache_frames_ * channels;
+            auto block = voice.position / framesPerBlock;
+            auto offset = voice.position % framesPerBlock;
+            if (voice.decodedBlock != block) {
+                AdpcmCodec::decodeBlock(*voice.adpcm, block, cache);
+                voice.decodedBlock = block;
+            }
+            count = std::min(count, framesPerBlock - offset);
+            std::copy_n(cache + static_cast<size_t>(offset) * channels, count * channels, dst);
+        } else if (voice.position < voice.residentFrames) {
+            count = std::min(count, voice.residentFrames - voice.position);
+            std::copy_n(voice.data + static_cast<size_t>(voice.position) * channels, count * channels, dst);
+        } else {
+            auto got = voice.streamed ? streamer_->read(index, reinterpret_cast<uint8_t*>(dst), count) : 0;
+            if (got < count) {
+                if (voice.streamed) {
+                    streamer_->drop(index, count - got);
+                }
+                std::fill(dst + static_cast<size_t>(got) * channels, dst + static_cast<size_t>(count) * channels, 0);
+            }
+        }
+        dst += static_cast<size_t>(count) * channels;
+        voice.position += count;
+        available -= count;
+    }
+    voice.position += silent;
+}
+
+template <typename Sample, uint16_t Channels>
+void RenderEngine::sumGroups(uint32_t chunk, uint32_t) {
+    // Always in group order, whichever thread rendered the groups.
+    const auto channels = this->channels<Channels>();
+    const auto samples = static_cast<size_t>(format_.periodSize) * channels;
+    auto begin = static_cast<size_t>(format_.periodSize * chunk / kSumChunks) * channels;
+    auto end = static_cast<size_t>(format_.periodSize * (chunk + 1) / kSumChunks) * channels;
+    if constexpr (std::is_void_v<Sample>) {
+        RenderPipeline::sumGeneric(format_.audioFormat, group_mix_.data(), samples, group_count_, begin, end,
+                                   period_.data());
+    } else {
+        RenderPipeline::sum<Sample>(group_mix_.data(), samples, group_count_, begin, end, period_.data());
+    }
+}
+
+void RenderEngine::selectLoops() {
+    switch (format_.audioFormat.channels) {
+        case 1:
+            selectSum<1>();
+            break;
+        case 2:
+            selectSum<2>();
+            break;
+        case 4:
+            selectSum<4>();
+            break;
+        case 6:
+            selectSum<6>();
+            break;
+        case 8:
+            selectSum<8>();
+            break;
+        default:
+            selectSum<0>();
+            break;
+    }
+}
+
+template <uint16_t Channels>
+void RenderEngine::selectSum() {
+    render_group_ = &RenderEngine::renderGroup<Channels>;
+    switch (RenderPipeline::outputOf(format_.audioFormat)) {
+        case RenderPipeline::Output::kInt16:
+            sum_groups_ = &RenderEngine::sumGroups<int16_t, Channels>;
+            break;
+        case RenderPipeline::Output::kInt32:
+            sum_groups_ = &RenderEngine::sumGroups<int32_t, Channels>;
+            break;
+        case RenderPipeline::Output::kFloat:
+            sum_groups_ = &RenderEngine::sumGroups<float, Channels>;
+            break;
+        case RenderPipeline::Output::kUnsupported:
+            sum_groups_ = nullptr;
+            break;
+    }
+}
+
+void RenderEngine::useGenericLoops() {
+    if (running_ || !sum_groups_) {
+        return;
+    }
+    render_group_ = &RenderEngine::renderGroup<0>;
+    sum_groups_ = &RenderEngine::sumGroups<void, 0>;
+}
+
+RenderEngine::Scratch RenderEngine::makeScratch() const {
+    // source frames of one period at the highest pitch, plus the history
+    const auto channels = format_.audioFormat.channels;
+    const auto fetchSize = static_cast<size_t>(kMaxPitchRatio * format_.periodSize + 2) * channels;
+    return Scratch{
+        .stream = std::vector<uint8_t>(static_cast<size_t>(format_.periodSize) * channels * sizeof(int16_t)),
+        .pitchFetch = std::vector<int16_t>(fetchSize),
+        .pitchWindow = std::vector<Interpolator::Sample>(fetchSize + Interpolator::kMaxTaps * channels)
+    };
+}
+
+uint32_t RenderEngine::nextRandom() {
+    // xorshift32, picks one of the round-robin samples of an instrument
+    random_state_ ^= random_state_ << 13;
+    random_state_ ^= random_state_ >> 17;
+    random_state_ ^= random_state_ << 5;
+    return random_state_;
+}
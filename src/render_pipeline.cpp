@@ -0,0 +1,38 @@
+#include "rpi_sound/render_pipeline.hpp"
+
+RenderPipeline::Output RenderPipeline::outputOf(const AudioFormat& format) {
+    if (format.isFloat) {
+        return format.bitsPerSample == 32 ? Output::kFloat : Output::kUnsupported;
+    }
+    switch (format.bitsPerSample) {
+        case 16:
+            return Output::kInt16;
+        case 32:
+            return Output::kInt32;
+        default:
+            return Output::kUnsupported;
+    }
+}
+
+void RenderPipeline::sumGeneric(const AudioFormat& format, const int32_t* buffers, size_t stride, uint32_t count,
+                                size_t begin, size_t end, uint8_t* out) {
+    for (auto i = begin; i < end; ++i) {
+        int32_t sum{0};
+        for (uint32_t buffer = 0; buffer < count; ++buffer) {
+            sum += buffers[buffer * stride + i];
+        }
+        switch (outputOf(format)) {
+            case Output::kInt16:
+                reinterpret_cast<int16_t*>(out)[i] = toOutput<int16_t>(sum);
+                break;
+            case Output::kInt32:
+                reinterpret_cast<int32_t*>(out)[i] = toOutput<int32_t>(sum);
+                break;
+            case Output::kFloat:
+                reinterpret_cast<float*>(out)[i] = toOutput<float>(sum);
+                break;
+            case Output::kUnsupported:
+                break;
+        }
+    }
+}
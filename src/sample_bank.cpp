@@ -0,0 +1,184 @@
+#include <algorithm>
+#include <fstream>
+#include <iostream>
+#include <system_error>
+
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include "rpi_sound/adpcm_parser.hpp"
+#include "rpi_sound/pcm_converter.hpp"
+#include "rpi_sound/sample_bank.hpp"
+#include "rpi_sound/wav_parser.hpp"
+
+namespace fs = std::filesystem;
+
+namespace {
+    constexpr auto kTuningFile{"tuning.txt"};
+
+    std::vector<fs::path> sortedEntries(const fs::path& dir, bool directories) {
+        std::vector<fs::path> entries;
+        std::error_code ec;
+        for (const auto& entry : fs::directory_iterator(dir, ec)) {
+            if (directories ? entry.is_directory(ec) : entry.is_regular_file(ec)) {
+                entries.push_back(entry.path());
+            }
+        }
+        std::sort(entries.begin(), entries.end());
+        return entries;
+    }
+
+    bool loadConverted(const std::string& path, const AudioFormat& format, uint32_t frameSize, Sample& sample) {
+        PCMConverter converter;
+        if (!converter.load(path) || !converter.convertToHwPCM(format)) {
+            return false;
+        }
+        sample.pcm = converter.getData();
+        sample.frameCount = static_cast<uint32_t>(sample.pcm->data.size() / frameSize);
+        sample.residentFrames = sample.frameCount;
+        sample.dataOffset = 0;
+        return true;
+    }
+
+    bool loadHead(const std::string& path, const AudioFormat& format, uint32_t frameSize,
+                  uint32_t residentFrames, Sample& sample) {
+        // Opened before parsing, so the head and the tail are from the same file.
+        auto fd = ::open(path.c_str(), O_RDONLY | O_CLOEXEC);
+        if (fd < 0) {
+            return false;
+        }
+        auto file = std::make_shared<const SampleFile>(fd);
+
+        // Streamed tails are read as they are, so there is no conversion here.
+        WavParser parser;
+        parser.setResidentLimit(residentFrames * frameSize);
+        if (!parser.load(path) || parser.getAudioFormat() != format) {
+            return false;
+        }
+        struct stat opened{};
+        struct stat parsed{};
+        if (fstat(fd, &opened) != 0 || stat(path.c_str(), &parsed) != 0 || opened.st_ino != parsed.st_ino) {
+            // replaced while loading, the next reload picks it up
+            return false;
+        }
+        sample.pcm = parser.getPCMData();
+        sample.frameCount = parser.getDataSize() / frameSize;
+        sample.residentFrames = static_cast<uint32_t>(sample.pcm->data.size() / frameSize);
+        sample.dataOffset = parser.getDataOffset();
+        if (sample.residentFrames < sample.frameCount) {
+            sample.file = std::move(file);
+        }
+        return true;
+    }
+
+    bool loadCompressed(const std::string& path, const AudioFormat& format, Sample& sample) {
+        AdpcmParser parser;
+        if (!parser.load(path) || parser.getAudioFormat() != format) {
+            return false;
+        }
+        sample.adpcm = parser.getCompressedData();
+        sample.frameCount = sample.adpcm->frameCount;
+        sample.residentFrames = sample.frameCount;
+        sample.dataOffset = 0;
+        return true;
+    }
+}
+
+std::shared_ptr<const SampleBank> SampleBank::load(const std::string_view& kitPath,
+                                                   const AudioFormat& format,
+                                                   const SampleBank* previous,
+                                                   const SampleBankOptions& options) {
+    std::error_code ec;
+    if (!fs::is_directory(kitPath, ec)) {
+        std::cout << "Kit directory not found: " << kitPath << "\r\n";
+        return nullptr;
+    }
+
+    const auto frameSize = static_cast<uint32_t>(format.channels * (format.bitsPerSample / 8));
+    const auto residentFrames = static_cast<uint32_t>(static_cast<uint64_t>(format.sampleRate) * options.residentMs / 1000);
+    std::vector<Instrument> instruments;
+
+    for (const auto& instrumentDir : sortedEntries(fs::path{kitPath}, true)) {
+        Instrument instrument;
+        instrument.name = instrumentDir.filename().string();
+        instrument.id = instrumentId(instrument.name);
+        std::ifstream tuning{instrumentDir / kTuningFile};
+        if (tuning && !(tuning >> instrument.tuning)) {
+            std::cout << "Invalid tuning: " << instrument.name << "\r\n";
+            instrument.tuning = 0;
+        }
+
+        for (const auto& file : sortedEntries(instrumentDir, false)) {
+            if (file.extension() != ".wav") {
+                continue;
+            }
+            auto modified = fs::last_write_time(file, ec);
+            if (ec) {
+                continue;
+            }
+
+            auto path = file.string();
+            const Sample* cached = previous ? previous->findSample(path) : nullptr;
+            if (cached && cached->modified == modified) {
+                instrument.samples.push_back(*cached);
+                continue;
+            }
+
+            Sample sample{.path = path, .modified = modified};
+            auto isLoaded{false};
+            if (options.compressed) {
+                isLoaded = loadCompressed(path, format, sample);
+            } else if (residentFrames > 0) {
+                isLoaded = loadHead(path, format, frameSize, residentFrames, sample);
+            } else {
+                isLoaded = loadConverted(path, format, frameSize, sample);
+            }
+            if (!isLoaded) {
+                std::cout << "Skipping sample: " << path << "\r\n";
+                continue;
+            }
+            instrument.samples.push_back(std::move(sample));
+        }
+
+        if (!instrument.samples.empty()) {
+            instruments.push_back(std::move(instrument));
+        }
+    }
+
+    return std::make_shared<const SampleBank>(format, std::move(instruments));
+}
+
+SampleFile::~SampleFile() {
+    ::close(fd_);
+}
+
+const Instrument* SampleBank::findInstrument(uint32_t id) const {
+    for (const auto& instrument : instruments_) {
+        if (instrument.id == id) {
+            return &instrument;
+        }
+    }
+    return nullptr;
+}
+
+size_t SampleBank::residentBytes() const {
+    size_t bytes = 0;
+    for (const auto& instrument : instruments_) {
+        for (const auto& sample : instrument.samples) {
+            bytes += sample.adpcm ? sample.adpcm->blocks.size() : sample.pcm->data.size();
+        }
+    }
+    return bytes;
+}
+
+const Sample* SampleBank::findSample(const std::string& path) const {
+    for (const auto& instrument : instruments_) {
+        for (const auto& sample : instrument.samples) {
+            if (sample.path == path) {
+                return &sample;
+            }
+        }
+    }
+    return nullptr;
+}
@@ -1,18 +1,25 @@
 #include <algorithm>
+#include <cerrno>
 #include <numeric>
 
 #include "rpi_sound/tiny_alsa_wrapper.hpp"
 
 bool TinyAlsaWrapper::openDevice(uint32_t card, uint32_t device, bool isOutput, HWAudioFormat& config) {
+    // an open PCM holds the device until it is closed, so reopening gives EBUSY
+    pcm_.reset();
     pcm_ = std::make_unique<PCM>();
 
-    if (!pcm_->initialize(card, device, isOutput, config)) {
+    if (!pcm_->initialize(card, device, isOutput, config, is_non_blocking_)) {
         std::cout << "PCM Init failed!\r\n";
         return false;
     }
     return true;
 }
 
+void TinyAlsaWrapper::closeDevice() {
+    pcm_.reset();
+}
+
 bool TinyAlsaWrapper::getDeviceFormat(uint32_t card, uint32_t device, bool isOutput, HWAudioFormat& config) {
     pcm_params *params;
     const pcm_mask *mask;
@@ -46,10 +53,10 @@ bool TinyAlsaWrapper::getDeviceFormat(uint32_t card, uint32_t device, bool isOut
     return true;
 }
 
-void TinyAlsaWrapper::writeData(const std::vector<uint8_t>& data) {
+bool TinyAlsaWrapper::writeData(const std::vector<uint8_t>& data) {
     if (!pcm_) {
         std::cout << "PCM not initialized!\r\n";
-        return;
+        return false;
     }
 
     auto bufferSize = static_cast<uint32_t>(pcm_frames_to_bytes(pcm_->get(), pcm_->getFormat().periodSize));
@@ -64,11 +71,26 @@ void TinyAlsaWrapper::writeData(const std::vector<uint8_t>& data) {
                                             bufferSize));
         if (written_frames < 0) {
             std::cout << std::string{pcm_get_error(pcm_->get())} << "error playing sample";
-            break;
+            return false;
         }
         remainingSize -= bufferSize;
         playedSize += pcm_frames_to_bytes(pcm_->get(), written_frames);
     } while (bufferSize > 0 && remainingSize > 0);
+    return true;
+}
+
+int32_t TinyAlsaWrapper::readData(uint8_t* data, uint32_t frames) {
+    if (!pcm_) {
+        std::cout << "PCM not initialized!\r\n";
+        return -1;
+    }
+
+    // tinyalsa recovers from overruns itself and reports them as an error
+    auto readFrames = pcm_readi(pcm_->get(), data, frames);
+    if (readFrames < 0) {
+        std::cout << std::string{pcm_get_error(pcm_->get())} << " error capturing\r\n";
+    }
+    return readFrames;
 }
 
 HWAudioFormat TinyAlsaWrapper::getDefaultFormat() {
@@ -83,4 +105,59 @@ HWAudioFormat TinyAlsaWrapper::getDefaultFormat() {
     };
 
     return defaultFormat;
-}
\ No newline at end of file
+}
+
+int TinyAlsaWrapper::getPollFd() const {
+    return pcm_ ? pcm_get_file_descriptor(pcm_->get()) : -1;
+}
+
+int32_t TinyAlsaWrapper::writeAvailable(const uint8_t* data, uint32_t frames) {
+    if (!pcm_) {
+        std::cout << "PCM not initialized!\r\n";
+        return -1;
+    }
+
+    // avail can exceed the buffer after an underrun, pcm_writei() restarts the stream then
+    auto avail = pcm_avail_update(pcm_->get());
+    if (avail < 0) {
+        std::cout << std::string{pcm_get_error(pcm_->get())} << " error querying avail\r\n";
+        return avail;
+    }
+    frames = std::min({frames, static_cast<uint32_t>(avail), pcm_get_buffer_size(pcm_->get())});
+    if (frames == 0) {
+        return 0;
+    }
+
+    auto written = pcm_writei(pcm_->get(), data, frames);
+    if (written < 0) {
+        if (errno == EAGAIN) {
+            return 0;
+        }
+        std::cout << std::string{pcm_get_error(pcm_->get())} << " error playing sample\r\n";
+    }
+    return written;
+}
+
+int32_t TinyAlsaWrapper::getQueuedFrames() {
+    if (!pcm_) {
+        return -1;
+    }
+    auto avail = pcm_avail_update(pcm_->get());
+    if (avail < 0) {
+        return avail;
+    }
+    auto bufferSize = static_cast<int32_t>(pcm_get_buffer_size(pcm_->get()));
+    return std::max(bufferSize - avail, 0);
+}
+
+bool TinyAlsaWrapper::getTimestamp(uint32_t& available, timespec& time) {
+    if (!pcm_) {
+        return false;
+    }
+    unsigned int avail{0};
+    if (pcm_get_htimestamp(pcm_->get(), &avail, &time) != 0) {
+        return false;
+    }
+    available = avail;
+    return true;
+}
@@ -55,7 +55,10 @@ namespace {
     };
 }
 
-WavParser::WavParser() {
+WavParser::WavParser() :
+    resident_limit_{UINT32_MAX},
+    data_offset_{0},
+    data_size_{0} {
     std::cout << "Wav parser created!\r\n";
 }
 
@@ -74,9 +77,12 @@ bool WavParser::load(const std::string_view& filePath) {
     WavHeader wavHeader;
     file.read(reinterpret_cast<char*>(&wavHeader), sizeof(WavHeader));
 
-    // Read chunk header
+    // Read chunk header, skipping chunks placed before fmt (e.g. JUNK)
     ChunkHeader chunkHeader;
-    file.read(reinterpret_cast<char*>(&chunkHeader), sizeof(chunkHeader));
+    while (file.read(reinterpret_cast<char*>(&chunkHeader), sizeof(chunkHeader)) &&
+           std::memcmp(chunkHeader.fmt, kFmtHeader, std::size(kFmtHeader) - 1) != 0) {
+        file.seekg(chunkHeader.chunkSize + (chunkHeader.chunkSize & 1), std::ios::cur);
+    }
 
     // Read chunk format
     ChunkFormat chunkFormat;
@@ -129,11 +135,15 @@ bool WavParser::load(const std::string_view& filePath) {
                               chunkFormat.audioFormat == WaveFormat::kIeeeFloat,
                               chunkFormat.bitsPerSample);
 
+    data_offset_ = static_cast<uint64_t>(currentPos);
+    data_size_ = dataHeader.dataSize;
+    auto residentSize = std::min(dataHeader.dataSize, resident_limit_);
+
     pcm_data_ = std::make_shared<PCMData>();
-    pcm_data_->data = std::vector<uint8_t>(dataHeader.dataSize);
+    pcm_data_->data = std::vector<uint8_t>(residentSize);
     pcm_data_->format = format;
 
-    if(!file.read(reinterpret_cast<char*>(pcm_data_->data.data()), dataHeader.dataSize)) {
+    if(!file.read(reinterpret_cast<char*>(pcm_data_->data.data()), residentSize)) {
         return false;
     }
 
@@ -146,4 +156,16 @@ std::shared_ptr<PCMData> WavParser::getPCMData() const {
 
 AudioFormat WavParser::getAudioFormat() const {
     return pcm_data_->format;
+}
+
+void WavParser::setResidentLimit(uint32_t maxBytes) {
+    resident_limit_ = maxBytes;
+}
+
+uint64_t WavParser::getDataOffset() const {
+    return data_offset_;
+}
+
+uint32_t WavParser::getDataSize() const {
+    return data_size_;
 }
\ No newline at end of file
@@ -0,0 +1,199 @@
+#include <algorithm>
+#include <array>
+#include <cerrno>
+#include <cstring>
+#include <iostream>
+
+#include <fcntl.h>
+#include <unistd.h>
+
+#include "rpi_sound/wav_writer.hpp"
+
+namespace {
+    constexpr size_t kAlign{4096};
+    constexpr uint32_t kDs64Size{28};
+    constexpr uint32_t kFmtSize{40};
+    // RIFF + JUNK/ds64 + fmt + data chunk headers
+    constexpr size_t kHeaderSize{12 + 8 + kDs64Size + 8 + kFmtSize + 8};
+    constexpr uint16_t kWaveFormatExtensible{0xFFFE};
+    constexpr std::array<uint8_t, 14> kSubFormatGuidTail{
+        0x00, 0x00, 0x00, 0x00, 0x10, 0x00, 0x80, 0x00, 0x00, 0xAA, 0x00, 0x38, 0x9B, 0x71
+    };
+
+    template <typename T>
+    void put(uint8_t*& out, T value) {
+        std::memcpy(out, &value, sizeof(value));
+        out += sizeof(value);
+    }
+
+    void putTag(uint8_t*& out, const char* tag) {
+        std::memcpy(out, tag, 4);
+        out += 4;
+    }
+}
+
+WavWriter::~WavWriter() {
+    close();
+}
+
+bool WavWriter::open(const std::string& path, const AudioFormat& format, const WavWriterOptions& options) {
+    close();
+    if (options.blockSize % kAlign != 0 || options.blockSize <= kHeaderSize) {
+        std::cout << "Invalid block size: " << options.blockSize << "\r\n";
+        return false;
+    }
+
+    constexpr int kFlags{O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC};
+    is_direct_ = options.directIo;
+    fd_ = ::open(path.c_str(), kFlags | (is_direct_ ? O_DIRECT : 0), 0644);
+    if (fd_ < 0 && is_direct_ && errno == EINVAL) {
+        std::cout << "O_DIRECT not supported, using buffered I/O\r\n";
+        is_direct_ = false;
+        fd_ = ::open(path.c_str(), kFlags, 0644);
+    }
+    if (fd_ < 0) {
+        std::cout << "File open failed! " << path << "\r\n";
+        return false;
+    }
+
+    block_.reset(static_cast<uint8_t*>(std::aligned_alloc(kAlign, options.blockSize)));
+    format_ = format;
+    options_ = options;
+    file_offset_ = 0;
+    allocated_ = 0;
+    data_bytes_ = 0;
+
+    // placeholder header, patched in close()
+    buildHeader(block_.get());
+    block_fill_ = kHeaderSize;
+    return true;
+}
+
+bool WavWriter::write(const uint8_t* data, size_t bytes) {
+    if (fd_ < 0) {
+        return false;
+    }
+    while (bytes > 0) {
+        auto count = std::min(bytes, options_.blockSize - block_fill_);
+        std::memcpy(block_.get() + block_fill_, data, count);
+        block_fill_ += count;
+        data_bytes_ += count;
+        data += count;
+        bytes -= count;
+
+        if (block_fill_ == options_.blockSize) {
+            if (!flushBlock(options_.blockSize)) {
+                return false;
+            }
+            block_fill_ = 0;
+        }
+    }
+    return true;
+}
+
+bool WavWriter::close() {
+    if (fd_ < 0) {
+        return false;
+    }
+
+    auto tail = block_fill_;
+    if (data_bytes_ & 1) {
+        // RIFF chunks are padded to an even size
+        block_.get()[tail++] = 0;
+    }
+    auto fileSize = file_offset_ + tail;
+    auto isOk{true};
+    if (tail > 0) {
+        // O_DIRECT needs whole sectors, the padding is truncated again below
+        auto padded = is_direct_ ? (tail + kAlign - 1) / kAlign * kAlign : tail;
+        std::memset(block_.get() + tail, 0, padded - tail);
+        isOk = flushBlock(padded);
+    }
+    isOk = ftruncate(fd_, static_cast<off_t>(fileSize)) == 0 && isOk;
+
+    if (is_direct_) {
+        fcntl(fd_, F_SETFL, fcntl(fd_, F_GETFL) & ~O_DIRECT);
+    }
+    std::array<uint8_t, kHeaderSize> header;
+    buildHeader(header.data());
+    isOk = pwrite(fd_, header.data(), header.size(), 0) == static_cast<ssize_t>(header.size()) && isOk;
+    isOk = fdatasync(fd_) == 0 && isOk;
+
+    ::close(fd_);
+    fd_ = -1;
+    block_.reset();
+    if (!isOk) {
+        std::cout << "Finalizing WAV file failed!\r\n";
+    }
+    return isOk;
+}
+
+bool WavWriter::flushBlock(size_t bytes) {
+    if (options_.preallocateBytes > 0 && file_offset_ + bytes > allocated_) {
+        auto length = std::max<uint64_t>(options_.preallocateBytes, bytes);
+        if (fallocate(fd_, FALLOC_FL_KEEP_SIZE, static_cast<off_t>(allocated_), static_cast<off_t>(length)) == 0) {
+            allocated_ += length;
+        } else {
+            // not supported by the file system, e.g. FAT
+            options_.preallocateBytes = 0;
+        }
+    }
+
+    size_t written = 0;
+    while (written < bytes) {
+        auto ret = pwrite(fd_, block_.get() + written, bytes - written, static_cast<off_t>(file_offset_ + written));
+        if (ret < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            std::cout << "Write failed: " << std::strerror(errno) << "\r\n";
+            return false;
+        }
+        written += static_cast<size_t>(ret);
+    }
+    file_offset_ += bytes;
+    return true;
+}
+
+void WavWriter::buildHeader(uint8_t* header) const {
+    const uint16_t bytesPerSample = format_.bitsPerSample / 8;
+    const uint16_t blockAlign = format_.channels * bytesPerSample;
+    const uint64_t riffSize = kHeaderSize - 8 + data_bytes_ + (data_bytes_ & 1);
+    const bool isRf64 = riffSize > UINT32_MAX;
+
+    auto* out = header;
+    putTag(out, isRf64 ? "RF64" : "RIFF");
+    put<uint32_t>(out, isRf64 ? UINT32_MAX : static_cast<uint32_t>(riffSize));
+    putTag(out, "WAVE");
+
+    // Reserved as JUNK so it can become the ds64 chunk without moving data.
+    putTag(out, isRf64 ? "ds64" : "JUNK");
+    put<uint32_t>(out, kDs64Size);
+    std::memset(out, 0, kDs64Size);
+    if (isRf64) {
+        put<uint64_t>(out, riffSize);
+        put<uint64_t>(out, data_bytes_);
+        put<uint64_t>(out, blockAlign ? data_bytes_ / blockAlign : 0);
+        put<uint32_t>(out, 0);
+    } else {
+        out += kDs64Size;
+    }
+
+    putTag(out, "fmt ");
+    put<uint32_t>(out, kFmtSize);
+    put<uint16_t>(out, kWaveFormatExtensible);
+    put<uint16_t>(out, format_.channels);
+    put<uint32_t>(out, format_.sampleRate);
+    put<uint32_t>(out, format_.sampleRate * blockAlign);
+    put<uint16_t>(out, blockAlign);
+    put<uint16_t>(out, bytesPerSample * 8);
+    put<uint16_t>(out, 22);
+    put<uint16_t>(out, format_.bitsPerSample);
+    put<uint32_t>(out, 0);
+    put<uint16_t>(out, format_.isFloat ? 3 : 1);
+    std::memcpy(out, kSubFormatGuidTail.data(), kSubFormatGuidTail.size());
+    out += kSubFormatGuidTail.size();
+
+    putTag(out, "data");
+    put<uint32_t>(out, isRf64 ? UINT32_MAX : static_cast<uint32_t>(data_bytes_));
+}
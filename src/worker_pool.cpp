@@ -0,0 +1,186 @@
+#include <algorithm>
+
+#include <pthread.h>
+#include <sched.h>
+
+#include "rpi_sound/worker_pool.hpp"
+
+namespace {
+    constexpr uint32_t kSpinDivisor{8};     // spin for an eighth of the period
+    constexpr std::chrono::microseconds kDefaultSpin{50};
+
+    constexpr uint64_t pack(uint32_t epoch, uint32_t begin, uint32_t end) {
+        return static_cast<uint64_t>(epoch) << 32 | static_cast<uint64_t>(begin) << 16 | end;
+    }
+
+    constexpr uint32_t epochOf(uint64_t range) {
+        return static_cast<uint32_t>(range >> 32);
+    }
+
+    constexpr uint32_t beginOf(uint64_t range) {
+        return static_cast<uint32_t>(range >> 16) & 0xffff;
+    }
+
+    constexpr uint32_t endOf(uint64_t range) {
+        return static_cast<uint32_t>(range) & 0xffff;
+    }
+
+    inline void cpuRelax() {
+#if defined(__x86_64__) || defined(__i386__)
+        __builtin_ia32_pause();
+#elif defined(__aarch64__) || defined(__arm__)
+        asm volatile("yield");
+#endif
+    }
+}
+
+WorkerPool::WorkerPool(uint32_t threads, std::chrono::nanoseconds period, int32_t callerCore) :
+    thread_count_{threads},
+    caller_core_{callerCore},
+    period_{period},
+    spin_{period.count() > 0 ? period / kSpinDivisor : std::chrono::nanoseconds{kDefaultSpin}},
+    ranges_{std::make_unique<Range[]>(threads + 1)} {
+    threads_.reserve(threads);
+    for (uint32_t worker = 1; worker <= threads; ++worker) {
+        threads_.emplace_back(&WorkerPool::workerLoop, this, worker);
+    }
+}
+
+WorkerPool::~WorkerPool() {
+    running_.store(false);
+    {
+        std::lock_guard<std::mutex> lock(park_mutex_);
+        park_condition_.notify_all();
+    }
+    for (auto& thread : threads_) {
+        thread.join();
+    }
+}
+
+void WorkerPool::run(uint32_t count, Task task, void* context) {
+    count = std::min(count, kMaxTasks);
+    if (count == 0) {
+        return;
+    }
+    // Only this thread writes the epoch, and no participant touches task_
+    // once the previous batch has finished.
+    auto epoch = epoch_.load(std::memory_order_relaxed) + 1;
+    task_ = task;
+    context_ = context;
+    remaining_.store(count, std::memory_order_relaxed);
+    const auto participants = threads() + 1;
+    for (uint32_t i = 0; i < participants; ++i) {
+        ranges_[i].value.store(pack(epoch, count * i / participants, count * (i + 1) / participants),
+                               std::memory_order_relaxed);
+    }
+    batch_start_.store(Clock::now().time_since_epoch().count(), std::memory_order_relaxed);
+
+    // Pairs with parked_ being raised before a worker checks the epoch.
+    epoch_.store(epoch, std::memory_order_seq_cst);
+    if (parked_.load(std::memory_order_seq_cst) > 0) {
+        std::lock_guard<std::mutex> lock(park_mutex_);
+        park_condition_.notify_all();
+    }
+
+    work(0, epoch);
+    while (remaining_.load(std::memory_order_acquire) != 0) {
+        cpuRelax();
+    }
+}
+
+bool WorkerPool::pinToCore(uint32_t core) {
+    if (core >= CPU_SETSIZE) {
+        return false;
+    }
+    cpu_set_t set;
+    CPU_ZERO(&set);
+    CPU_SET(core, &set);
+    return pthread_setaffinity_np(pthread_self(), sizeof(set), &set) == 0;
+}
+
+void WorkerPool::workerLoop(uint32_t worker) {
+    if (caller_core_ != kUnpinned) {
+        pinToCore(coreOf(worker, static_cast<uint32_t>(caller_core_), std::max(1u, std::thread::hardware_concurrency())));
+    }
+
+    uint32_t seen{0};
+    while (true) {
+        auto epoch = waitForBatch(seen);
+        if (!running_.load(std::memory_order_acquire)) {
+            return;
+        }
+        work(worker, epoch);
+        seen = epoch;
+    }
+}
+
+uint32_t WorkerPool::waitForBatch(uint32_t seen) {
+    if (!spinFor(seen, spin_) && period_.count() > 0) {
+        // Sleep through the rest of the period and be spinning when the next one is due.
+        auto due = Clock::time_point{Clock::duration{batch_start_.load(std::memory_order_relaxed)}} + period_;
+        park(seen, due - spin_);
+        if (!spinFor(seen, spin_ * 2)) {
+            park(seen, Clock::time_point::max());
+        }
+    } else if (epoch_.load(std::memory_order_acquire) == seen) {
+        park(seen, Clock::time_point::max());
+    }
+    return epoch_.load(std::memory_order_acquire);
+}
+
+bool WorkerPool::spinFor(uint32_t seen, std::chrono::nanoseconds duration) const {
+    auto end = Clock::now() + duration;
+    while (epoch_.load(std::memory_order_acquire) == seen && running_.load(std::memory_order_relaxed)) {
+        if (Clock::now() >= end) {
+            return false;
+        }
+        for (auto i = 0; i < 64; ++i) {
+            cpuRelax();
+        }
+    }
+    return true;
+}
+
+void WorkerPool::park(uint32_t seen, Clock::time_point deadline) {
+    std::unique_lock<std::mutex> lock(park_mutex_);
+    parked_.fetch_add(1, std::memory_order_seq_cst);
+    auto isWoken = [this, seen] {
+        return epoch_.load(std::memory_order_seq_cst) != seen || !running_.load(std::memory_order_relaxed);
+    };
+    if (deadline == Clock::time_point::max()) {
+        park_condition_.wait(lock, isWoken);
+    } else {
+        park_condition_.wait_until(lock, deadline, isWoken);
+    }
+    parked_.fetch_sub(1, std::memory_order_relaxed);
+}
+
+void WorkerPool::work(uint32_t worker, uint32_t epoch) {
+    const auto participants = threads() + 1;
+    uint32_t task;
+    for (uint32_t offset = 0; offset < participants; ++offset) {
+        auto participant = (worker + offset) % participants;
+        while (claim(participant, epoch, offset == 0, task)) {
+            task_(context_, task, worker);
+            remaining_.fetch_sub(1, std::memory_order_release);
+        }
+    }
+}
+
+bool WorkerPool::claim(uint32_t participant, uint32_t epoch, bool isOwner, uint32_t& task) {
+    // The owner takes from the front, thieves from the back. A range of an
+    // older or newer batch never matches the epoch, so a late worker cannot
+    // run a task of a batch it has not seen published.
+    auto& range = ranges_[participant].value;
+    auto value = range.load(std::memory_order_acquire);
+    while (epochOf(value) == epoch && beginOf(value) < endOf(value)) {
+        auto begin = beginOf(value);
+        auto end = endOf(value);
+        auto next = isOwner ? pack(epoch, begin + 1, end) : pack(epoch, begin, end - 1);
+        if (range.compare_exchange_weak(value, next, std::memory_order_acq_rel, std::memory_order_acquire)) {
+            task = isOwner ? begin : end - 1;
+            return true;
+        }
+    }
+    return false;
+}
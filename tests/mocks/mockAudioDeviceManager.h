@@ -0,0 +1,11 @@
+#include <gmock/gmock.h>
+
+#include "rpi_sound/iaudio_device_manager.hpp"
+
+class MockAudioDeviceManager : public IAudioDeviceManager {
+public:
+    MOCK_METHOD(std::vector<AudioDevice>, listDevices, (), (override));
+    MOCK_METHOD(bool, setDevice, (int32_t cardId, int32_t deviceId, AudioDevice::Type type), (override));
+    MOCK_METHOD(bool, writeData, (const std::vector<uint8_t>& data), (override));
+    MOCK_METHOD(bool, getTimestamp, (uint32_t& available, timespec& time), (override));
+};
@@ -0,0 +1,17 @@
+#include <gmock/gmock.h>
+
+#include "rpi_sound/iaudio_driver.hpp"
+
+class MockAudioDriver : public IAudioDriver {
+public:
+    MOCK_METHOD(bool, openDevice, (uint32_t card, uint32_t device, bool isOutput, HWAudioFormat& config), (override));
+    MOCK_METHOD(void, closeDevice, (), (override));
+    MOCK_METHOD(bool, getDeviceFormat, (uint32_t card, uint32_t device, bool isOutput, HWAudioFormat& config), (override));
+    MOCK_METHOD(bool, writeData, (const std::vector<uint8_t>& data), (override));
+    MOCK_METHOD(int32_t, readData, (uint8_t* data, uint32_t frames), (override));
+    MOCK_METHOD(HWAudioFormat, getDefaultFormat, (), (override));
+    MOCK_METHOD(int, getPollFd, (), (const, override));
+    MOCK_METHOD(int32_t, writeAvailable, (const uint8_t* data, uint32_t frames), (override));
+    MOCK_METHOD(int32_t, getQueuedFrames, (), (override));
+    MOCK_METHOD(bool, getTimestamp, (uint32_t& available, timespec& time), (override));
+};
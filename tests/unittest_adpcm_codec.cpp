@@ -0,0 +1,96 @@
+#include <gtest/gtest.h>
+
+#include <cmath>
+#include <cstring>
+#include <memory>
+
+#include "mocks/mockAudioDeviceManager.h"
+#include "rpi_sound/adpcm_codec.hpp"
+#include "rpi_sound/render_engine.hpp"
+
+namespace {
+    constexpr uint32_t kFrames{5000};
+
+    std::shared_ptr<PCMData> makeSine() {
+        auto pcm = std::make_shared<PCMData>();
+        pcm->format = AudioFormat{};
+        pcm->data.resize(kFrames * 2 * sizeof(int16_t));
+        auto* samples = reinterpret_cast<int16_t*>(pcm->data.data());
+        for (uint32_t i = 0; i < kFrames; ++i) {
+            samples[i * 2] = static_cast<int16_t>(12000 * std::sin(i * 0.05));
+            samples[i * 2 + 1] = static_cast<int16_t>(8000 * std::sin(i * 0.031));
+        }
+        return pcm;
+    }
+}
+
+class AdpcmCodecTest : public ::testing::Test {
+
+protected:
+
+    void SetUp() override {
+        pcm_ = makeSine();
+    }
+
+    std::shared_ptr<PCMData> pcm_;
+};
+
+TEST_F(AdpcmCodecTest, TestRoundTripIsClose) {
+    // When
+    auto adpcm = AdpcmCodec::encode(*pcm_);
+
+    // Then
+    auto decoded = AdpcmCodec::decode(*adpcm);
+
+    // Expect
+    ASSERT_EQ(decoded->data.size(), pcm_->data.size());
+    const auto* original = reinterpret_cast<const int16_t*>(pcm_->data.data());
+    const auto* result = reinterpret_cast<const int16_t*>(decoded->data.data());
+    double signal = 0;
+    double noise = 0;
+    for (size_t i = 0; i < kFrames * 2; ++i) {
+        signal += static_cast<double>(original[i]) * original[i];
+        noise += static_cast<double>(original[i] - result[i]) * (original[i] - result[i]);
+    }
+    EXPECT_GT(10 * std::log10(signal / noise), 30.0);
+}
+
+TEST_F(AdpcmCodecTest, TestQuarterSize) {
+    // When
+    auto adpcm = AdpcmCodec::encode(*pcm_);
+
+    // Expect
+    EXPECT_EQ(adpcm->frameCount, kFrames);
+    EXPECT_LT(adpcm->blocks.size() * 3, pcm_->data.size());
+}
+
+TEST_F(AdpcmCodecTest, TestEngineDecodesBlocksPerVoice) {
+    // When
+    HWAudioFormat format{};
+    format.periodSize = 700;
+    format.periodCount = 2;
+    RenderEngine engine{std::make_unique<::testing::NiceMock<MockAudioDeviceManager>>(), format};
+
+    auto adpcm = AdpcmCodec::encode(*pcm_);
+    Instrument instrument{"ride", SampleBank::instrumentId("ride"), {}};
+    instrument.samples.push_back(Sample{"ride.wav", {}, nullptr, adpcm, kFrames, kFrames, 0});
+    ASSERT_TRUE(engine.publishBank(
+        std::make_shared<const SampleBank>(format.audioFormat, std::vector<Instrument>{instrument})));
+
+    // Then
+    engine.trigger("ride", 127);
+    std::vector<int16_t> rendered;
+    for (uint32_t frame = 0; frame < kFrames; frame += format.periodSize) {
+        const auto& data = engine.renderPeriod();
+        auto offset = rendered.size();
+        rendered.resize(offset + data.size() / sizeof(int16_t));
+        std::memcpy(rendered.data() + offset, data.data(), data.size());
+    }
+
+    // Expect
+    auto decoded = AdpcmCodec::decode(*adpcm);
+    const auto* expected = reinterpret_cast<const int16_t*>(decoded->data.data());
+    for (size_t i = 0; i < kFrames * 2; ++i) {
+        ASSERT_EQ(rendered[i], static_cast<int16_t>((expected[i] * 32767) >> 15)) << "at " << i;
+    }
+}
@@ -0,0 +1,154 @@
+#include <gtest/gtest.h>
+
+#include <chrono>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <memory>
+#include <thread>
+
+#include "mocks/mockAudioDeviceManager.h"
+#include "rpi_sound/render_engine.hpp"
+
+namespace {
+    constexpr uint32_t kSampleRate{1000};
+    constexpr uint32_t kPeriodSize{64};
+    constexpr uint32_t kFrames{kPeriodSize * 4};
+
+    void writeWav(const std::filesystem::path& path, const std::vector<int16_t>& samples) {
+        uint32_t dataSize = samples.size() * sizeof(int16_t);
+        uint32_t riffSize = 36 + dataSize;
+        uint32_t fmtSize = 16;
+        uint16_t pcm = 1;
+        uint16_t channels = 2;
+        uint32_t rate = kSampleRate;
+        uint32_t byteRate = rate * channels * 2;
+        uint16_t blockAlign = channels * 2;
+        uint16_t bits = 16;
+
+        std::ofstream file(path, std::ios::binary);
+        file.write("RIFF", 4).write(reinterpret_cast<char*>(&riffSize), 4).write("WAVE", 4);
+        file.write("fmt ", 4).write(reinterpret_cast<char*>(&fmtSize), 4);
+        file.write(reinterpret_cast<char*>(&pcm), 2).write(reinterpret_cast<char*>(&channels), 2);
+        file.write(reinterpret_cast<char*>(&rate), 4).write(reinterpret_cast<char*>(&byteRate), 4);
+        file.write(reinterpret_cast<char*>(&blockAlign), 2).write(reinterpret_cast<char*>(&bits), 2);
+        file.write("data", 4).write(reinterpret_cast<char*>(&dataSize), 4);
+        file.write(reinterpret_cast<const char*>(samples.data()), dataSize);
+    }
+}
+
+class DiskStreamerTest : public ::testing::Test {
+
+protected:
+
+    void SetUp() override {
+        kit_ = std::filesystem::temp_directory_path() / "rpisound_stream_test";
+        std::filesystem::create_directories(kit_ / "tom");
+        for (uint32_t i = 0; i < kFrames * 2; ++i) {
+            samples_.push_back(static_cast<int16_t>(i));
+        }
+        writeWav(kit_ / "tom" / "tom_0.wav", samples_);
+
+        HWAudioFormat format{};
+        format.periodSize = kPeriodSize;
+        format.periodCount = 2;
+        format.audioFormat = AudioFormat{kSampleRate};
+        testee_ = std::make_unique<RenderEngine>(
+            std::make_unique<::testing::NiceMock<MockAudioDeviceManager>>(), format);
+    }
+
+    void TearDown() override {
+        testee_.reset();
+        std::filesystem::remove_all(kit_);
+    }
+
+    std::vector<int16_t> renderVoice() {
+        std::vector<int16_t> rendered;
+        for (uint32_t period = 0; period < kFrames / kPeriodSize; ++period) {
+            const auto& data = testee_->renderPeriod();
+            auto offset = rendered.size();
+            rendered.resize(offset + data.size() / sizeof(int16_t));
+            std::memcpy(rendered.data() + offset, data.data(), data.size());
+            // the resident head normally covers the disk latency
+            std::this_thread::sleep_for(std::chrono::milliseconds(50));
+        }
+        return rendered;
+    }
+
+    std::vector<int16_t> expected() const {
+        std::vector<int16_t> expected;
+        for (auto value : samples_) {
+            expected.push_back(static_cast<int16_t>((value * 32767) >> 15));
+        }
+        return expected;
+    }
+
+    std::filesystem::path kit_;
+    std::vector<int16_t> samples_;
+    std::unique_ptr<RenderEngine> testee_;
+};
+
+TEST_F(DiskStreamerTest, TestBankKeepsOnlyHeadResident) {
+    // When
+    auto bank = SampleBank::load(kit_.string(), testee_->format().audioFormat, nullptr, SampleBankOptions{kPeriodSize});
+
+    // Then
+    const auto& sample = bank->findInstrument(SampleBank::instrumentId("tom"))->samples.at(0);
+
+    // Expect
+    EXPECT_EQ(sample.frameCount, kFrames);
+    EXPECT_EQ(sample.residentFrames, kPeriodSize);
+    EXPECT_EQ(sample.pcm->data.size(), kPeriodSize * 2 * sizeof(int16_t));
+}
+
+TEST_F(DiskStreamerTest, TestTailIsStreamed) {
+    // When
+    ASSERT_TRUE(testee_->enableStreaming(kFrames));
+    ASSERT_TRUE(testee_->publishBank(
+        SampleBank::load(kit_.string(), testee_->format().audioFormat, nullptr, SampleBankOptions{kPeriodSize})));
+
+    // Then
+    testee_->trigger("tom", 127);
+    auto rendered = renderVoice();
+
+    // Expect
+    EXPECT_EQ(rendered, expected());
+    EXPECT_EQ(testee_->streamUnderruns(), 0);
+}
+
+TEST_F(DiskStreamerTest, TestReplacedFileKeepsStreamingOldTail) {
+    // When
+    ASSERT_TRUE(testee_->enableStreaming(kFrames));
+    ASSERT_TRUE(testee_->publishBank(
+        SampleBank::load(kit_.string(), testee_->format().audioFormat, nullptr, SampleBankOptions{kPeriodSize})));
+    // a new file under the same name, as the kit watcher would pick up
+    std::filesystem::remove(kit_ / "tom" / "tom_0.wav");
+    writeWav(kit_ / "tom" / "tom_0.wav", std::vector<int16_t>(samples_.size(), 1000));
+
+    // Then
+    testee_->trigger("tom", 127);
+    auto rendered = renderVoice();
+
+    // Expect
+    EXPECT_EQ(rendered, expected());
+    EXPECT_EQ(testee_->streamUnderruns(), 0);
+}
+
+TEST_F(DiskStreamerTest, TestTailWithoutFileCountsOpenFailure) {
+    // When
+    ASSERT_TRUE(testee_->enableStreaming(kFrames));
+    auto loaded = SampleBank::load(kit_.string(), testee_->format().audioFormat, nullptr, SampleBankOptions{kPeriodSize});
+    auto instruments = loaded->instruments();
+    instruments.at(0).samples.at(0).file.reset();
+    ASSERT_TRUE(testee_->publishBank(std::make_shared<const SampleBank>(loaded->format(), std::move(instruments))));
+
+    // Then
+    testee_->trigger("tom", 127);
+    testee_->renderPeriod();
+    for (auto i = 0; i < 100 && testee_->streamOpenFailures() == 0; ++i) {
+        std::this_thread::sleep_for(std::chrono::milliseconds(5));
+    }
+
+    // Expect
+    EXPECT_EQ(testee_->streamOpenFailures(), 1);
+}
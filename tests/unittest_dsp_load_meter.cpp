@@ -0,0 +1,90 @@
+#include <gtest/gtest.h>
+
+#include <chrono>
+#include <memory>
+#include <thread>
+
+#include "rpi_sound/dsp_load_meter.hpp"
+
+class DspLoadMeterTest : public ::testing::Test {
+
+protected:
+
+    void SetUp() override {
+        // 1 ms deadline
+        HWAudioFormat format{};
+        format.periodSize = 48;
+        format.audioFormat = AudioFormat{48000};
+        testee_ = std::make_unique<DspLoadMeter>(format);
+    }
+
+    std::unique_ptr<DspLoadMeter> testee_;
+};
+
+TEST_F(DspLoadMeterTest, TestNothingPublishedBeforeFirstPeriodEnds) {
+    // When
+    testee_->beginPeriod();
+    testee_->mark(DspLoadMeter::kVoices);
+
+    // Then
+    auto snapshot = testee_->snapshot();
+
+    // Expect
+    EXPECT_EQ(snapshot.periods, 0);
+    EXPECT_DOUBLE_EQ(snapshot.deadlineUs, 1000.0);
+}
+
+TEST_F(DspLoadMeterTest, TestSlowStageMissesDeadline) {
+    // When
+    testee_->beginPeriod();
+    std::this_thread::sleep_for(std::chrono::milliseconds(2));
+    testee_->mark(DspLoadMeter::kVoices);
+    testee_->mark(DspLoadMeter::kConversion);
+    testee_->beginPeriod();
+
+    // Then
+    auto snapshot = testee_->snapshot();
+
+    // Expect
+    EXPECT_EQ(snapshot.periods, 1);
+    EXPECT_EQ(snapshot.deadlineMisses, 1);
+    EXPECT_GE(snapshot.worstUs[DspLoadMeter::kVoices], 2000.0);
+    EXPECT_LT(snapshot.worstUs[DspLoadMeter::kConversion], 1000.0);
+    EXPECT_GE(snapshot.load, 200.0);
+}
+
+TEST_F(DspLoadMeterTest, TestDriverWriteIsNotLoad) {
+    // When
+    testee_->beginPeriod();
+    testee_->mark(DspLoadMeter::kVoices);
+    std::this_thread::sleep_for(std::chrono::milliseconds(2));
+    testee_->mark(DspLoadMeter::kDriverWrite);
+    testee_->beginPeriod();
+
+    // Then
+    auto snapshot = testee_->snapshot();
+
+    // Expect
+    EXPECT_EQ(snapshot.deadlineMisses, 0);
+    EXPECT_GE(snapshot.worstUs[DspLoadMeter::kDriverWrite], 2000.0);
+    EXPECT_LT(snapshot.load, 100.0);
+}
+
+TEST_F(DspLoadMeterTest, TestStageMarkedTwiceAddsUp) {
+    // When
+    testee_->beginPeriod();
+    std::this_thread::sleep_for(std::chrono::milliseconds(1));
+    testee_->mark(DspLoadMeter::kVoices);
+    testee_->mark(DspLoadMeter::kConversion);
+    std::this_thread::sleep_for(std::chrono::milliseconds(1));
+    testee_->mark(DspLoadMeter::kVoices);
+    testee_->mark(DspLoadMeter::kDriverWrite);
+    testee_->beginPeriod();
+
+    // Then
+    auto snapshot = testee_->snapshot();
+
+    // Expect
+    EXPECT_GE(snapshot.worstUs[DspLoadMeter::kVoices], 2000.0);
+    EXPECT_LT(snapshot.worstUs[DspLoadMeter::kDriverWrite], 1000.0);
+}
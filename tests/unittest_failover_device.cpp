@@ -0,0 +1,164 @@
+#include <gtest/gtest.h>
+
+#include <atomic>
+#include <chrono>
+#include <filesystem>
+#include <fstream>
+#include <memory>
+#include <mutex>
+#include <thread>
+
+#include "mocks/mockAudioDriver.h"
+#include "rpi_sound/failover_device.hpp"
+
+using ::testing::_;
+using ::testing::Return;
+
+namespace {
+    constexpr auto kTimeout{std::chrono::seconds(2)};
+
+    void touch(const std::filesystem::path& path, const std::string& content = {}) {
+        std::ofstream file{path};
+        file << content;
+    }
+}
+
+class FailoverDeviceTest : public ::testing::Test {
+
+protected:
+
+    void SetUp() override {
+        root_ = std::filesystem::temp_directory_path() / "rpisound_failover_test";
+        std::filesystem::create_directories(root_ / "snd");
+        addCard(0, "Headphones");
+        addCard(1, "A4");
+
+        testee_ = std::make_unique<FailoverDevice>([this]() {
+            auto driver = std::make_unique<::testing::NiceMock<MockAudioDriver>>();
+            auto openedCard = std::make_shared<std::atomic<uint32_t>>(UINT32_MAX);
+            ON_CALL(*driver, openDevice(_, _, _, _)).WillByDefault(
+                [this, openedCard](uint32_t card, uint32_t, bool, HWAudioFormat&) {
+                    *openedCard = card;
+                    std::lock_guard lock{mutex_};
+                    opened_cards_.push_back(card);
+                    return true;
+                });
+            ON_CALL(*driver, writeData(_)).WillByDefault([this, openedCard](const std::vector<uint8_t>&) {
+                if (*openedCard == failing_card_) {
+                    ++failed_writes_;
+                    return false;
+                }
+                return true;
+            });
+            std::lock_guard lock{mutex_};
+            drivers_.push_back(driver.get());
+            return driver;
+        }, (root_ / "snd").string(), root_.string());
+    }
+
+    void TearDown() override {
+        testee_.reset();
+        std::filesystem::remove_all(root_);
+    }
+
+    void addCard(int32_t card, const std::string& id) {
+        std::filesystem::create_directories(root_ / ("card" + std::to_string(card)));
+        touch(root_ / ("card" + std::to_string(card)) / "id", id + "\n");
+        touch(root_ / "snd" / ("pcmC" + std::to_string(card) + "D0p"));
+    }
+
+    MockAudioDriver* driver(size_t index) {
+        std::lock_guard lock{mutex_};
+        return index < drivers_.size() ? drivers_[index] : nullptr;
+    }
+
+    std::vector<uint32_t> openedCards() {
+        std::lock_guard lock{mutex_};
+        return opened_cards_;
+    }
+
+    // Keeps writing periods like the render thread until the condition holds.
+    template <typename Condition>
+    bool writeUntil(Condition condition) {
+        auto deadline = std::chrono::steady_clock::now() + kTimeout;
+        while (!condition()) {
+            if (std::chrono::steady_clock::now() > deadline) {
+                return false;
+            }
+            testee_->writeData(period_);
+            std::this_thread::sleep_for(std::chrono::milliseconds(5));
+        }
+        return true;
+    }
+
+    std::filesystem::path root_;
+    std::mutex mutex_;
+    std::vector<MockAudioDriver*> drivers_;
+    std::vector<uint32_t> opened_cards_;
+    std::atomic<uint32_t> failing_card_{UINT32_MAX};
+    std::atomic<uint32_t> failed_writes_{0};
+    std::vector<uint8_t> period_ = std::vector<uint8_t>(64);
+    std::unique_ptr<FailoverDevice> testee_;
+};
+
+TEST_F(FailoverDeviceTest, TestFailedPeriodGoesToFallback) {
+    // When
+    ASSERT_TRUE(testee_->setDevice(1, 0, AudioDevice::Type::kPlayback));
+    ASSERT_TRUE(testee_->setFallback("Headphones", 0));
+    auto* primary = driver(0);
+    auto* fallback = driver(1);
+
+    // Then
+    EXPECT_CALL(*primary, writeData(_)).WillOnce(Return(false));
+    EXPECT_CALL(*fallback, writeData(_)).WillOnce(Return(true));
+
+    // Expect
+    EXPECT_TRUE(testee_->writeData(period_));
+    EXPECT_TRUE(testee_->isOnFallback());
+    EXPECT_EQ(testee_->failovers(), 1);
+}
+
+TEST_F(FailoverDeviceTest, TestUnplugAndReplugSwitchesBack) {
+    // When
+    ASSERT_TRUE(testee_->setDevice(1, 0, AudioDevice::Type::kPlayback));
+    ASSERT_TRUE(testee_->setFallback("Headphones", 0));
+    std::filesystem::remove(root_ / "snd" / "pcmC1D0p");
+    ASSERT_TRUE(writeUntil([this]() { return testee_->isOnFallback(); }));
+
+    // the card comes back under another number
+    std::filesystem::remove_all(root_ / "card1");
+    addCard(2, "A4");
+    ASSERT_TRUE(writeUntil([this]() { return !testee_->isOnFallback(); }));
+
+    // Then
+    EXPECT_CALL(*driver(2), writeData(_)).WillOnce(Return(true));
+    EXPECT_CALL(*driver(1), writeData(_)).Times(0);
+
+    // Expect
+    EXPECT_TRUE(testee_->writeData(period_));
+    EXPECT_EQ(openedCards(), (std::vector<uint32_t>{1, 0, 2}));
+    EXPECT_EQ(testee_->failovers(), 1);
+}
+
+TEST_F(FailoverDeviceTest, TestCardFailingInPlaceStaysOnFallback) {
+    // When
+    ASSERT_TRUE(testee_->setDevice(1, 0, AudioDevice::Type::kPlayback));
+    ASSERT_TRUE(testee_->setFallback("Headphones", 0));
+    failing_card_ = 1;
+
+    // Then
+    auto deadline = std::chrono::steady_clock::now() + std::chrono::milliseconds(400);
+    auto periods{0};
+    while (std::chrono::steady_clock::now() < deadline) {
+        EXPECT_TRUE(testee_->writeData(period_));
+        ++periods;
+        std::this_thread::sleep_for(std::chrono::milliseconds(2));
+    }
+
+    // Expect
+    // retried after 100 ms and then 200 ms later, not every period
+    EXPECT_GT(periods, 50);
+    EXPECT_LE(failed_writes_, 3);
+    EXPECT_EQ(testee_->failovers(), failed_writes_);
+    EXPECT_TRUE(testee_->isOnFallback());
+}
@@ -0,0 +1,69 @@
+#include <gtest/gtest.h>
+
+#include <cmath>
+
+#include "rpi_sound/frame_clock.hpp"
+
+namespace {
+    constexpr uint32_t kSampleRate{48000};
+    constexpr uint32_t kPeriodSize{256};
+    constexpr int64_t kStart{5000000000};
+
+    // time of frame on a card running at rate frames per second
+    int64_t timeOf(int64_t frame, double rate) {
+        return kStart + std::llround(static_cast<double>(frame) * 1e9 / rate);
+    }
+}
+
+class FrameClockTest : public ::testing::Test {
+
+protected:
+
+    FrameClock testee_{kSampleRate};
+};
+
+TEST_F(FrameClockTest, TestNotLockedBeforeEnoughSamples) {
+    // When
+    for (size_t period = 0; period + 1 < FrameClock::kMinSamples; ++period) {
+        testee_.addSample(timeOf(period * kPeriodSize, kSampleRate), period * kPeriodSize);
+    }
+
+    // Then
+    auto isLocked = testee_.isLocked();
+    testee_.addSample(timeOf(FrameClock::kMinSamples * kPeriodSize, kSampleRate), FrameClock::kMinSamples * kPeriodSize);
+
+    // Expect
+    EXPECT_FALSE(isLocked);
+    EXPECT_TRUE(testee_.isLocked());
+}
+
+TEST_F(FrameClockTest, TestFollowsDriftingCardThroughJitter) {
+    // When
+    // the card runs 0.05% fast and the timestamps jitter by +-40 us
+    constexpr double kRate{kSampleRate * 1.0005};
+    for (int64_t period = 0; period < 100; ++period) {
+        auto jitter = (period % 3 - 1) * 40000;
+        testee_.addSample(timeOf(period * kPeriodSize, kRate) + jitter, period * kPeriodSize);
+    }
+
+    // Then
+    constexpr int64_t kFrame{100 * kPeriodSize + 123};
+    auto frame = testee_.frameAt(timeOf(kFrame, kRate));
+
+    // Expect
+    EXPECT_NEAR(frame, kFrame, 1);
+}
+
+TEST_F(FrameClockTest, TestJumpStartsNewFit) {
+    // When
+    for (int64_t period = 0; period < 10; ++period) {
+        testee_.addSample(timeOf(period * kPeriodSize, kSampleRate), period * kPeriodSize);
+    }
+
+    // Then
+    // an xrun, the card restarted 100 ms behind
+    testee_.addSample(timeOf(10 * kPeriodSize, kSampleRate), 10 * kPeriodSize - kSampleRate / 10);
+
+    // Expect
+    EXPECT_FALSE(testee_.isLocked());
+}
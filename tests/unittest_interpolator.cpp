@@ -0,0 +1,122 @@
+#include <gtest/gtest.h>
+
+#include <cmath>
+#include <numbers>
+#include <vector>
+
+#include "rpi_sound/interpolator.hpp"
+
+namespace {
+    constexpr uint16_t kChannels{2};
+    constexpr int32_t kUnityGain{32768};
+
+    // kHistory frames of padding in front, so position 0 is src[kHistory]
+    std::vector<Interpolator::Sample> makeSource(uint32_t frames, int16_t (*value)(uint32_t)) {
+        std::vector<Interpolator::Sample> src((frames + Interpolator::kMaxTaps) * kChannels, 0);
+        for (uint32_t frame = 0; frame < frames + Interpolator::kLookahead; ++frame) {
+            for (uint16_t channel = 0; channel < kChannels; ++channel) {
+                src[(frame + Interpolator::kHistory) * kChannels + channel] = value(frame);
+            }
+        }
+        return src;
+    }
+
+    std::vector<int32_t> render(Interpolation mode, const std::vector<Interpolator::Sample>& src, uint64_t increment,
+                                uint32_t frames) {
+        std::vector<int32_t> out(frames * kChannels, 0);
+        constexpr uint64_t kStart = static_cast<uint64_t>(Interpolator::kHistory) << 32;
+        Interpolator::mix(mode, src.data(), kChannels, kStart, increment, frames, kUnityGain, out.data());
+        return out;
+    }
+}
+
+TEST(InterpolatorTest, TestIncrementFromCents) {
+    // Expect
+    EXPECT_EQ(Interpolator::increment(0), Interpolator::kUnity);
+    EXPECT_EQ(Interpolator::increment(1200), Interpolator::kUnity * 2);
+    EXPECT_EQ(Interpolator::increment(-1200), Interpolator::kUnity / 2);
+}
+
+TEST(InterpolatorTest, TestLinearHalfRateInterpolatesMidpoints) {
+    // When
+    auto src = makeSource(16, [](uint32_t frame) { return static_cast<int16_t>(frame * 100); });
+
+    // Then
+    auto out = render(Interpolation::kLinear, src, Interpolator::kUnity / 2, 8);
+
+    // Expect
+    for (uint32_t frame = 0; frame < 8; ++frame) {
+        EXPECT_EQ(out[frame * kChannels], static_cast<int32_t>(frame * 50));
+        EXPECT_EQ(out[frame * kChannels + 1], static_cast<int32_t>(frame * 50));
+    }
+}
+
+TEST(InterpolatorTest, TestCubicPassesSamplesAtWholeFrames) {
+    // When
+    auto src = makeSource(32, [](uint32_t frame) { return static_cast<int16_t>((frame * 7919) % 2000 - 1000); });
+
+    // Then
+    auto out = render(Interpolation::kCubic, src, Interpolator::kUnity * 2, 16);
+
+    // Expect
+    for (uint32_t frame = 0; frame < 16; ++frame) {
+        EXPECT_EQ(out[frame * kChannels], static_cast<int32_t>(src[(frame * 2 + Interpolator::kHistory) * kChannels]));
+    }
+}
+
+TEST(InterpolatorTest, TestAllModesKeepDcLevel) {
+    // When
+    std::vector<Interpolator::Sample> src((256 + Interpolator::kMaxTaps) * kChannels, 10000);
+    auto increment = Interpolator::increment(-317);
+
+    for (auto mode : {Interpolation::kLinear, Interpolation::kCubic, Interpolation::kSinc}) {
+        // Then
+        auto out = render(mode, src, increment, 128);
+
+        // Expect
+        for (auto value : out) {
+            EXPECT_NEAR(value, 10000, 2) << "mode " << static_cast<int>(mode);
+        }
+    }
+}
+
+TEST(InterpolatorTest, TestSincPitchedUpDoesNotAlias) {
+    // When
+    // 0.8 of Nyquist, which is 1.6 of it an octave up and would alias to 0.4
+    auto src = makeSource(1200, [](uint32_t frame) {
+        return static_cast<int16_t>(std::lround(10000 * std::sin(std::numbers::pi * 0.8 * frame)));
+    });
+
+    // Then
+    auto out = render(Interpolation::kSinc, src, Interpolator::kUnity * 2, 512);
+
+    // Expect
+    // past the zero padding in front, which the kernel reaches into
+    double power{0};
+    for (uint32_t frame = Interpolator::kMaxTaps; frame < 512; ++frame) {
+        power += static_cast<double>(out[frame * kChannels]) * out[frame * kChannels];
+    }
+    auto rms = std::sqrt(power / (512 - Interpolator::kMaxTaps));
+    // the input is at 10000 / sqrt(2), so more than 20 dB down. With the
+    // cutoff at Nyquist the alias is only about 2 dB below the input.
+    EXPECT_LT(rms, 707.0);
+}
+
+#ifdef RPI_SOUND_FIXED_POINT
+TEST(InterpolatorTest, TestFixedPointRowsSumToExactlyUnity) {
+    // When
+    std::vector<Interpolator::Sample> src((1024 + Interpolator::kMaxTaps) * kChannels, 32767);
+    // odd fraction, so the positions sweep every coefficient row
+    constexpr uint64_t kIncrement{Interpolator::kUnity + 0x01234567};
+
+    for (auto mode : {Interpolation::kLinear, Interpolation::kCubic, Interpolation::kSinc}) {
+        // Then
+        auto out = render(mode, src, kIncrement, 1000);
+
+        // Expect
+        for (auto value : out) {
+            ASSERT_EQ(value, 32767) << "mode " << static_cast<int>(mode);
+        }
+    }
+}
+#endif
@@ -0,0 +1,202 @@
+#include <gtest/gtest.h>
+
+#include <algorithm>
+#include <chrono>
+#include <filesystem>
+#include <fstream>
+#include <memory>
+#include <thread>
+
+#include <sys/stat.h>
+
+#include "mocks/mockAudioDriver.h"
+#include "rpi_sound/detached_task.hpp"
+#include "rpi_sound/player.hpp"
+#include "rpi_sound/wav_writer.hpp"
+
+using ::testing::_;
+using ::testing::Return;
+
+namespace {
+    constexpr uint32_t kPeriodSize{64};
+    constexpr uint32_t kBufferFrames{kPeriodSize * 4};
+    constexpr uint32_t kFrameBytes{4};
+    constexpr uint32_t kSoundFrames{kPeriodSize * 5 + 10};
+}
+
+class PlayerAsyncTest : public ::testing::Test {
+
+protected:
+
+    void SetUp() override {
+        sound_ = std::filesystem::temp_directory_path() / "rpisound_player_test.wav";
+        std::vector<int16_t> samples(kSoundFrames * 2);
+        for (size_t i = 0; i < samples.size(); ++i) {
+            samples[i] = static_cast<int16_t>(i + 1);
+        }
+        WavWriter writer;
+        ASSERT_TRUE(writer.open(sound_.string(), AudioFormat{}));
+        ASSERT_TRUE(writer.write(reinterpret_cast<const uint8_t*>(samples.data()), samples.size() * 2));
+        ASSERT_TRUE(writer.close());
+
+        // Fake device: takes what fits into its buffer, playDevice() drains it.
+        auto driver = std::make_unique<::testing::NiceMock<MockAudioDriver>>();
+        ON_CALL(*driver, openDevice(_, _, true, _)).WillByDefault(Return(true));
+        ON_CALL(*driver, getQueuedFrames()).WillByDefault([this]() {
+            return static_cast<int32_t>(queued_);
+        });
+        ON_CALL(*driver, writeAvailable(_, _)).WillByDefault([this](const uint8_t* data, uint32_t frames) {
+            frames = std::min(frames, kBufferFrames - queued_);
+            output_.insert(output_.end(), data, data + frames * kFrameBytes);
+            queued_ += frames;
+            return static_cast<int32_t>(frames);
+        });
+        testee_ = std::make_unique<Player>(std::move(driver));
+
+        HWAudioFormat format{};
+        format.periodSize = kPeriodSize;
+        format.periodCount = kBufferFrames / kPeriodSize;
+        format.audioFormat = AudioFormat{};
+        ASSERT_TRUE(testee_->open(0, 0, format));
+    }
+
+    void TearDown() override {
+        std::filesystem::remove(sound_);
+    }
+
+    void playPeriod() {
+        queued_ -= std::min(queued_, kPeriodSize);
+        testee_->onWritable();
+    }
+
+    void waitForLoads() {
+        for (auto i = 0; i < 1000 && testee_->isLoading(); ++i) {
+            std::this_thread::sleep_for(std::chrono::milliseconds{1});
+        }
+        ASSERT_FALSE(testee_->isLoading());
+    }
+
+    DetachedTask playTwice(uint32_t& finished) {
+        for (auto i = 0; i < 2; ++i) {
+            if (co_await testee_->playAsync(sound_.string())) {
+                ++finished;
+            }
+        }
+    }
+
+    std::filesystem::path sound_;
+    uint32_t queued_{0};
+    std::vector<uint8_t> output_;
+    std::unique_ptr<Player> testee_;
+};
+
+TEST_F(PlayerAsyncTest, TestResumesWhenSoundIsPlayedOut) {
+    // When
+    uint32_t finished{0};
+    playTwice(finished);
+    waitForLoads();
+
+    // Then
+    testee_->onWritable();
+    uint32_t periods{0};
+    while (finished == 0) {
+        playPeriod();
+        ++periods;
+    }
+    // the second file is requested when the first one is done
+    waitForLoads();
+    playPeriod();
+
+    // Expect
+    // done once the last frame has left the device buffer, not earlier
+    EXPECT_EQ(periods, (kSoundFrames + kPeriodSize - 1) / kPeriodSize);
+    ASSERT_GT(output_.size(), kSoundFrames * kFrameBytes);
+    const auto* samples = reinterpret_cast<const int16_t*>(output_.data());
+    EXPECT_EQ(samples[0], 1);
+    EXPECT_EQ(samples[kSoundFrames * 2 - 1], static_cast<int16_t>(kSoundFrames * 2));
+    // the second sound is queued behind the silence written meanwhile
+    const auto* end = samples + output_.size() / sizeof(int16_t);
+    EXPECT_NE(std::find(samples + kSoundFrames * 2, end, 1), end);
+}
+
+TEST_F(PlayerAsyncTest, TestKeepsDeviceRunningOnSilence) {
+    // When
+    testee_->onWritable();
+
+    // Then
+    playPeriod();
+
+    // Expect
+    EXPECT_EQ(queued_, kBufferFrames);
+    EXPECT_TRUE(std::all_of(output_.begin(), output_.end(), [](uint8_t byte) { return byte == 0; }));
+}
+
+TEST_F(PlayerAsyncTest, TestMissingFileResumesWithFalse) {
+    // When
+    auto result{true};
+    [&]() -> DetachedTask {
+        result = co_await testee_->playAsync("missing.wav");
+    }();
+
+    // Then
+    waitForLoads();
+    testee_->onWritable();
+
+    // Expect
+    EXPECT_FALSE(result);
+}
+
+TEST_F(PlayerAsyncTest, TestLoadingDoesNotBlockLoop) {
+    // When
+    // the loader blocks in open() until the fifo has a writer
+    auto fifo = std::filesystem::temp_directory_path() / "rpisound_player_fifo.wav";
+    std::filesystem::remove(fifo);
+    ASSERT_EQ(mkfifo(fifo.c_str(), 0600), 0);
+    auto isResumed{false};
+    [&]() -> DetachedTask {
+        co_await testee_->playAsync(fifo.string());
+        isResumed = true;
+    }();
+
+    // Then
+    for (auto i = 0; i < 8; ++i) {
+        playPeriod();
+    }
+    auto isLoading = testee_->isLoading();
+    auto silentFrames = output_.size() / kFrameBytes;
+    // an empty file unblocks the loader, it can't be parsed
+    std::ofstream{fifo};
+    waitForLoads();
+    playPeriod();
+    std::filesystem::remove(fifo);
+
+    // Expect
+    EXPECT_TRUE(isLoading);
+    // the first period fills the buffer, each one after it tops it up
+    EXPECT_EQ(silentFrames, kBufferFrames + 7 * kPeriodSize);
+    EXPECT_TRUE(isResumed);
+}
+
+TEST_F(PlayerAsyncTest, TestDestroyingPlayerResumesPendingWithFalse) {
+    // When
+    auto held = std::make_shared<int>(0);
+    std::vector<bool> results;
+    auto playOnce = [](Player& player, std::string path, std::shared_ptr<int>, std::vector<bool>& results) -> DetachedTask {
+        results.push_back(co_await player.playAsync(path));
+    };
+    playOnce(*testee_, sound_.string(), held, results);
+    playOnce(*testee_, sound_.string(), held, results);
+    waitForLoads();
+    // the first sound is written and playing, the second one queued
+    testee_->onWritable();
+    playPeriod();
+    playPeriod();
+
+    // Then
+    testee_.reset();
+
+    // Expect
+    EXPECT_EQ(results, (std::vector<bool>{false, false}));
+    // both coroutine frames are freed
+    EXPECT_EQ(held.use_count(), 1);
+}
@@ -0,0 +1,282 @@
+#include <gtest/gtest.h>
+
+#include <algorithm>
+#include <cmath>
+#include <filesystem>
+#include <fstream>
+#include <memory>
+#include <numbers>
+#include <thread>
+
+#include <sys/stat.h>
+
+#include "mocks/mockAudioDriver.h"
+#include "rpi_sound/playlist.hpp"
+#include "rpi_sound/wav_writer.hpp"
+
+using ::testing::_;
+using ::testing::InSequence;
+using ::testing::Return;
+
+namespace {
+    constexpr uint32_t kPeriodSize{64};
+    constexpr uint32_t kBufferFrames{kPeriodSize * 4};
+    constexpr uint32_t kFrameBytes{4};
+    constexpr uint32_t kFirstFrames{kPeriodSize * 5 + 10};
+    constexpr uint32_t kSecondFrames{kPeriodSize * 3 + 7};
+    constexpr int16_t kSecondStart{20000};
+}
+
+class PlaylistTest : public ::testing::Test {
+
+protected:
+
+    void SetUp() override {
+        first_ = std::filesystem::temp_directory_path() / "rpisound_playlist_first.wav";
+        second_ = std::filesystem::temp_directory_path() / "rpisound_playlist_second.wav";
+        fifo_ = std::filesystem::temp_directory_path() / "rpisound_playlist_fifo.wav";
+
+        // Fake device: takes what fits into its buffer, playPeriod() drains it.
+        auto driver = std::make_unique<::testing::NiceMock<MockAudioDriver>>();
+        ON_CALL(*driver, openDevice(_, _, true, _)).WillByDefault(Return(true));
+        ON_CALL(*driver, getQueuedFrames()).WillByDefault([this]() {
+            return static_cast<int32_t>(queued_);
+        });
+        ON_CALL(*driver, writeAvailable(_, _)).WillByDefault([this](const uint8_t* data, uint32_t frames) {
+            frames = std::min(frames, kBufferFrames - queued_);
+            const auto* samples = reinterpret_cast<const int16_t*>(data);
+            output_.insert(output_.end(), samples, samples + frames * 2);
+            queued_ += frames;
+            return static_cast<int32_t>(frames);
+        });
+        driver_ = driver.get();
+        testee_ = std::make_unique<Playlist>(std::move(driver));
+
+        format_.periodSize = kPeriodSize;
+        format_.periodCount = kBufferFrames / kPeriodSize;
+        format_.audioFormat = AudioFormat{};
+        ASSERT_TRUE(testee_->open(0, 0, format_));
+    }
+
+    void TearDown() override {
+        testee_.reset();
+        std::filesystem::remove(first_);
+        std::filesystem::remove(second_);
+        std::filesystem::remove(fifo_);
+    }
+
+    // the loader blocks in open() on the fifo until unblockLoader()
+    void appendFifo() {
+        std::filesystem::remove(fifo_);
+        ASSERT_EQ(mkfifo(fifo_.c_str(), 0600), 0);
+        ASSERT_TRUE(testee_->append(fifo_.string()));
+    }
+
+    // an empty file, so that load fails
+    void unblockLoader() {
+        std::ofstream{fifo_};
+    }
+
+    static void writeWav(const std::filesystem::path& path, const std::vector<int16_t>& samples) {
+        WavWriter writer;
+        ASSERT_TRUE(writer.open(path.string(), AudioFormat{}));
+        ASSERT_TRUE(writer.write(reinterpret_cast<const uint8_t*>(samples.data()), samples.size() * 2));
+        ASSERT_TRUE(writer.close());
+    }
+
+    void waitForPrefetch(size_t tracks) {
+        for (auto i = 0; i < 1000 && testee_->prefetched() < tracks; ++i) {
+            std::this_thread::sleep_for(std::chrono::milliseconds{1});
+        }
+        ASSERT_EQ(testee_->prefetched(), tracks);
+    }
+
+    void playPeriods(uint32_t periods) {
+        testee_->onWritable();
+        for (uint32_t i = 0; i < periods; ++i) {
+            queued_ -= std::min(queued_, kPeriodSize);
+            testee_->onWritable();
+        }
+    }
+
+    void playUntilIdle() {
+        testee_->onWritable();
+        for (auto i = 0; i < 100 && !testee_->isIdle(); ++i) {
+            queued_ -= std::min(queued_, kPeriodSize);
+            testee_->onWritable();
+        }
+        ASSERT_TRUE(testee_->isIdle());
+    }
+
+    // first sample of the output that isn't silence
+    size_t start() const {
+        auto it = std::find_if(output_.begin(), output_.end(), [](int16_t sample) { return sample != 0; });
+        return static_cast<size_t>(it - output_.begin());
+    }
+
+    std::filesystem::path first_;
+    std::filesystem::path second_;
+    std::filesystem::path fifo_;
+    HWAudioFormat format_{};
+    MockAudioDriver* driver_{nullptr};
+    uint32_t queued_{0};
+    std::vector<int16_t> output_;
+    std::unique_ptr<Playlist> testee_;
+};
+
+TEST_F(PlaylistTest, TestGaplessTransitionIsSampleExact) {
+    // When
+    std::vector<int16_t> first(kFirstFrames * 2);
+    std::vector<int16_t> second(kSecondFrames * 2);
+    for (size_t i = 0; i < first.size(); ++i) {
+        first[i] = static_cast<int16_t>(i + 1);
+    }
+    for (size_t i = 0; i < second.size(); ++i) {
+        second[i] = static_cast<int16_t>(kSecondStart + i);
+    }
+    writeWav(first_, first);
+    writeWav(second_, second);
+    ASSERT_TRUE(testee_->append(first_.string()));
+    ASSERT_TRUE(testee_->append(second_.string()));
+    waitForPrefetch(2);
+
+    // Then
+    playUntilIdle();
+
+    // Expect
+    auto begin = start();
+    ASSERT_GE(output_.size(), begin + first.size() + second.size());
+    EXPECT_TRUE(std::equal(first.begin(), first.end(), output_.begin() + begin));
+    EXPECT_TRUE(std::equal(second.begin(), second.end(), output_.begin() + begin + first.size()));
+    EXPECT_TRUE(std::all_of(output_.begin() + begin + first.size() + second.size(), output_.end(),
+                            [](int16_t sample) { return sample == 0; }));
+    EXPECT_EQ(testee_->underruns(), 0);
+}
+
+TEST_F(PlaylistTest, TestCrossfadeUsesEqualPowerGains) {
+    // When
+    constexpr int16_t kFirstLevel{16000};
+    constexpr int16_t kSecondLevel{8000};
+    constexpr uint32_t kFadeFrames{441};     // 10 ms at 44.1 kHz
+    constexpr uint32_t kTrackFrames{kFadeFrames * 3};
+    writeWav(first_, std::vector<int16_t>(kTrackFrames * 2, kFirstLevel));
+    writeWav(second_, std::vector<int16_t>(kTrackFrames * 2, kSecondLevel));
+    testee_->setCrossfade(std::chrono::milliseconds{10});
+    ASSERT_TRUE(testee_->append(first_.string()));
+    ASSERT_TRUE(testee_->append(second_.string()));
+    waitForPrefetch(2);
+
+    // Then
+    playUntilIdle();
+
+    // Expect
+    auto begin = start() / 2;
+    const auto fadeStart = begin + kTrackFrames - kFadeFrames;
+    EXPECT_EQ(output_[(fadeStart - 1) * 2], kFirstLevel);
+    for (uint32_t frame = 0; frame < kFadeFrames; frame += 55) {
+        auto angle = (frame + 0.5) / kFadeFrames * (std::numbers::pi / 2);
+        auto expected = kFirstLevel * std::cos(angle) + kSecondLevel * std::sin(angle);
+        EXPECT_NEAR(output_[(fadeStart + frame) * 2], expected, 1.0);
+        EXPECT_NEAR(output_[(fadeStart + frame) * 2 + 1], expected, 1.0);
+    }
+    // the tracks overlap, so the second one ends kFadeFrames early
+    const auto end = begin + kTrackFrames * 2 - kFadeFrames;
+    EXPECT_EQ(output_[(end - 1) * 2], kSecondLevel);
+    EXPECT_EQ(output_[end * 2], 0);
+}
+
+TEST_F(PlaylistTest, TestSkipsFileThatFailsToLoad) {
+    // When
+    writeWav(first_, std::vector<int16_t>(kFirstFrames * 2, 1000));
+    ASSERT_TRUE(testee_->append("missing.wav"));
+    ASSERT_TRUE(testee_->append(first_.string()));
+    waitForPrefetch(1);
+
+    // Then
+    playUntilIdle();
+
+    // Expect
+    EXPECT_EQ(std::count(output_.begin(), output_.end(), 1000), kFirstFrames * 2);
+    EXPECT_EQ(testee_->underruns(), 0);
+}
+
+TEST_F(PlaylistTest, TestFileFailingAfterTrackEndIsNoUnderrun) {
+    // When
+    writeWav(first_, std::vector<int16_t>(kFirstFrames * 2, 1000));
+    ASSERT_TRUE(testee_->append(first_.string()));
+    waitForPrefetch(1);
+    appendFifo();
+
+    // Then
+    playPeriods(kFirstFrames / kPeriodSize + 8);
+    unblockLoader();
+    playUntilIdle();
+
+    // Expect
+    EXPECT_EQ(std::count(output_.begin(), output_.end(), 1000), kFirstFrames * 2);
+    EXPECT_EQ(testee_->underruns(), 0);
+}
+
+TEST_F(PlaylistTest, TestTrackLoadedAfterTrackEndIsUnderrun) {
+    // When
+    writeWav(first_, std::vector<int16_t>(kFirstFrames * 2, 1000));
+    writeWav(second_, std::vector<int16_t>(kSecondFrames * 2, 2000));
+    ASSERT_TRUE(testee_->append(first_.string()));
+    waitForPrefetch(1);
+    appendFifo();
+    ASSERT_TRUE(testee_->append(second_.string()));
+
+    // Then
+    playPeriods(kFirstFrames / kPeriodSize + 8);
+    unblockLoader();
+    waitForPrefetch(1);
+    playUntilIdle();
+
+    // Expect
+    EXPECT_EQ(std::count(output_.begin(), output_.end(), 2000), kSecondFrames * 2);
+    EXPECT_EQ(testee_->underruns(), 1);
+}
+
+TEST_F(PlaylistTest, TestAppendAfterStopStartsOver) {
+    // When
+    writeWav(first_, std::vector<int16_t>(kFirstFrames * 2, 1000));
+    writeWav(second_, std::vector<int16_t>(kSecondFrames * 2, 2000));
+    ASSERT_TRUE(testee_->append(first_.string()));
+    waitForPrefetch(1);
+    testee_->onWritable();
+    // half a period fits, the other half is left over
+    queued_ -= kPeriodSize / 2;
+    testee_->onWritable();
+
+    // Then
+    testee_->stop();
+    ASSERT_TRUE(testee_->append(second_.string()));
+    waitForPrefetch(1);
+    playUntilIdle();
+
+    // Expect
+    EXPECT_EQ(std::count(output_.begin(), output_.end(), 1000), (kBufferFrames + kPeriodSize / 2) * 2);
+    EXPECT_EQ(std::count(output_.begin(), output_.end(), 2000), kSecondFrames * 2);
+    EXPECT_EQ(testee_->underruns(), 0);
+}
+
+TEST_F(PlaylistTest, TestReopenClosesDeviceFirst) {
+    // Expect
+    {
+        InSequence sequence;
+        EXPECT_CALL(*driver_, closeDevice());
+        EXPECT_CALL(*driver_, openDevice(0, 1, true, _)).WillOnce(Return(true));
+    }
+
+    // When
+    writeWav(first_, std::vector<int16_t>(kFirstFrames * 2, 1000));
+
+    // Then
+    ASSERT_TRUE(testee_->open(0, 1, format_));
+    ASSERT_TRUE(testee_->append(first_.string()));
+    waitForPrefetch(1);
+    playUntilIdle();
+
+    // Expect
+    EXPECT_EQ(std::count(output_.begin(), output_.end(), 1000), kFirstFrames * 2);
+}
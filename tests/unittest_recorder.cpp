@@ -0,0 +1,117 @@
+#include <gtest/gtest.h>
+
+#include <chrono>
+#include <cstring>
+#include <filesystem>
+#include <memory>
+#include <thread>
+
+#include "mocks/mockAudioDriver.h"
+#include "rpi_sound/recorder.hpp"
+#include "rpi_sound/wav_parser.hpp"
+
+using ::testing::_;
+using ::testing::Return;
+
+namespace {
+    constexpr uint32_t kSampleRate{96000};
+    constexpr uint32_t kChannels{4};
+    constexpr uint32_t kPeriodSize{256};
+    constexpr uint32_t kFrames{kPeriodSize * 40};
+
+    int32_t sampleAt(uint64_t index) {
+        // distinct low, middle and high bytes, sign bit set every other sample
+        return static_cast<int32_t>((index * 0x010203) & 0xFFFFFF) | ((index & 1) ? ~0xFFFFFF : 0);
+    }
+}
+
+class RecorderTest : public ::testing::Test {
+
+protected:
+
+    void SetUp() override {
+        path_ = std::filesystem::temp_directory_path() / "rpisound_recorder_test.wav";
+        format_.periodSize = kPeriodSize;
+        format_.periodCount = 4;
+        format_.audioFormat = AudioFormat{kSampleRate, kChannels, false, 24};
+
+        auto driver = std::make_unique<::testing::NiceMock<MockAudioDriver>>();
+        driver_ = driver.get();
+        ON_CALL(*driver_, readData(_, _)).WillByDefault([this](uint8_t* data, uint32_t frames) {
+            frames = std::min(frames, kFrames - produced_);
+            if (frames == 0) {
+                std::this_thread::sleep_for(std::chrono::milliseconds(1));
+                return int32_t{0};
+            }
+            auto* out = reinterpret_cast<int32_t*>(data);
+            for (uint32_t i = 0; i < frames * kChannels; ++i) {
+                out[i] = sampleAt(static_cast<uint64_t>(produced_) * kChannels + i);
+            }
+            produced_ += frames;
+            return static_cast<int32_t>(frames);
+        });
+        testee_ = std::make_unique<Recorder>(std::move(driver));
+    }
+
+    void TearDown() override {
+        testee_.reset();
+        std::filesystem::remove(path_);
+    }
+
+    std::filesystem::path path_;
+    HWAudioFormat format_{};
+    MockAudioDriver* driver_{nullptr};
+    uint32_t produced_{0};
+    std::unique_ptr<Recorder> testee_;
+};
+
+TEST_F(RecorderTest, TestCapturesPacked24BitWav) {
+    // When
+    EXPECT_CALL(*driver_, openDevice(1, 0, false, _)).WillOnce(Return(true));
+    ASSERT_TRUE(testee_->start(1, 0, format_, path_.string(), RecorderOptions{.ringBytes = 1 << 20}));
+    while (testee_->stats().capturedFrames < kFrames) {
+        std::this_thread::sleep_for(std::chrono::milliseconds(1));
+    }
+    ASSERT_TRUE(testee_->stop());
+
+    // Then
+    WavParser parser;
+    ASSERT_TRUE(parser.load(path_.string()));
+    auto stats = testee_->stats();
+
+    // Expect
+    EXPECT_EQ(stats.writtenFrames, kFrames);
+    EXPECT_EQ(stats.droppedFrames, 0);
+    EXPECT_EQ(parser.getAudioFormat().sampleRate, kSampleRate);
+    EXPECT_EQ(parser.getAudioFormat().channels, kChannels);
+    EXPECT_EQ(parser.getAudioFormat().bitsPerSample, 24);
+
+    const auto& data = parser.getPCMData()->data;
+    ASSERT_EQ(data.size(), kFrames * kChannels * 3);
+    for (uint64_t i = 0; i < kFrames * kChannels; ++i) {
+        int32_t value{0};
+        std::memcpy(&value, data.data() + i * 3, 3);
+        ASSERT_EQ(value, sampleAt(i) & 0xFFFFFF) << "sample " << i;
+    }
+}
+
+TEST_F(RecorderTest, TestStartFailsWithoutDevice) {
+    // When
+    EXPECT_CALL(*driver_, openDevice(_, _, false, _)).WillOnce(Return(false));
+
+    // Expect
+    EXPECT_FALSE(testee_->start(1, 0, format_, path_.string()));
+    EXPECT_FALSE(testee_->stop());
+}
+
+TEST_F(RecorderTest, TestClosesDeviceWhenFileCannotBeOpened) {
+    // When
+    EXPECT_CALL(*driver_, openDevice(1, 0, false, _)).WillOnce(Return(true));
+    EXPECT_CALL(*driver_, closeDevice()).Times(1);
+
+    // Then
+    auto isStarted = testee_->start(1, 0, format_, (path_.parent_path() / "missing" / "take.wav").string());
+
+    // Expect
+    EXPECT_FALSE(isStarted);
+}
@@ -0,0 +1,332 @@
+#include <gtest/gtest.h>
+
+#include <algorithm>
+#include <chrono>
+#include <cstring>
+#include <memory>
+#include <thread>
+
+#include "mocks/mockAudioDeviceManager.h"
+#include "rpi_sound/render_engine.hpp"
+
+namespace {
+    constexpr uint32_t kPeriodSize{4};
+
+    std::shared_ptr<const SampleBank> makeBank(const std::string& instrument, int16_t value, uint32_t frames,
+                                               int32_t tuning = 0) {
+        AudioFormat format{};
+        auto pcm = std::make_shared<PCMData>();
+        pcm->format = format;
+        pcm->data.resize(frames * format.channels * sizeof(int16_t));
+        auto* samples = reinterpret_cast<int16_t*>(pcm->data.data());
+        std::fill(samples, samples + frames * format.channels, value);
+
+        Instrument inst{instrument, SampleBank::instrumentId(instrument), {}};
+        inst.samples.push_back(Sample{instrument + ".wav", {}, pcm, nullptr, frames, frames, 0});
+        inst.tuning = tuning;
+        return std::make_shared<const SampleBank>(format, std::vector<Instrument>{inst});
+    }
+
+    std::vector<int16_t> toSamples(const std::vector<uint8_t>& period) {
+        std::vector<int16_t> samples(period.size() / sizeof(int16_t));
+        std::memcpy(samples.data(), period.data(), period.size());
+        return samples;
+    }
+}
+
+class RenderEngineTest : public ::testing::Test {
+
+protected:
+
+    void SetUp() override {
+        HWAudioFormat format{};
+        format.periodSize = kPeriodSize;
+        format.periodCount = 2;
+        testee_ = std::make_unique<RenderEngine>(
+            std::make_unique<::testing::NiceMock<MockAudioDeviceManager>>(), format);
+    }
+
+    std::unique_ptr<RenderEngine> testee_;
+};
+
+TEST_F(RenderEngineTest, TestTriggerRendersSample) {
+    // When
+    ASSERT_TRUE(testee_->publishBank(makeBank("kick", 1000, kPeriodSize)));
+
+    // Then
+    testee_->trigger("kick", 127);
+    auto first = toSamples(testee_->renderPeriod());
+    auto second = toSamples(testee_->renderPeriod());
+
+    // Expect
+    EXPECT_EQ(first, std::vector<int16_t>(kPeriodSize * 2, 999));
+    EXPECT_EQ(second, std::vector<int16_t>(kPeriodSize * 2, 0));
+}
+
+TEST_F(RenderEngineTest, TestUnknownInstrumentIsSilent) {
+    // When
+    ASSERT_TRUE(testee_->publishBank(makeBank("kick", 1000, kPeriodSize)));
+
+    // Then
+    testee_->trigger("snare", 127);
+    auto period = toSamples(testee_->renderPeriod());
+
+    // Expect
+    EXPECT_EQ(period, std::vector<int16_t>(kPeriodSize * 2, 0));
+}
+
+TEST_F(RenderEngineTest, TestRetiredBankOutlivesPlayingVoice) {
+    // When
+    ASSERT_TRUE(testee_->publishBank(makeBank("kick", 1000, kPeriodSize * 3)));
+    testee_->trigger("kick", 127);
+    testee_->renderPeriod();
+
+    // Then
+    ASSERT_TRUE(testee_->publishBank(makeBank("kick", 2000, kPeriodSize)));
+    testee_->renderPeriod();
+    auto pendingWhilePlaying = testee_->collectRetired();
+    testee_->renderPeriod();
+    auto pendingAfterVoiceEnded = testee_->collectRetired();
+
+    // Expect
+    EXPECT_EQ(pendingWhilePlaying, 1);
+    EXPECT_EQ(pendingAfterVoiceEnded, 0);
+}
+
+TEST_F(RenderEngineTest, TestPitchedTriggerPlaysFaster) {
+    // When
+    ASSERT_TRUE(testee_->publishBank(makeBank("kick", 1000, kPeriodSize * 4)));
+
+    // Then
+    testee_->trigger("kick", 127, 1200);
+    auto first = toSamples(testee_->renderPeriod());
+    auto second = toSamples(testee_->renderPeriod());
+    auto third = toSamples(testee_->renderPeriod());
+
+    // Expect
+    // an octave up reads every other frame, which cubic passes unchanged
+    EXPECT_EQ(first, std::vector<int16_t>(kPeriodSize * 2, 999));
+    EXPECT_EQ(second, std::vector<int16_t>(kPeriodSize * 2, 999));
+    EXPECT_EQ(third, std::vector<int16_t>(kPeriodSize * 2, 0));
+}
+
+TEST_F(RenderEngineTest, TestInstrumentTuningSlowsVoiceDown) {
+    // When
+    ASSERT_TRUE(testee_->publishBank(makeBank("tom", 1000, kPeriodSize, -1200)));
+
+    // Then
+    testee_->trigger("tom", 127);
+    testee_->renderPeriod();
+    auto second = toSamples(testee_->renderPeriod());
+    auto third = toSamples(testee_->renderPeriod());
+
+    // Expect
+    EXPECT_NE(second, std::vector<int16_t>(kPeriodSize * 2, 0));
+    EXPECT_EQ(third, std::vector<int16_t>(kPeriodSize * 2, 0));
+}
+
+TEST_F(RenderEngineTest, TestWorkerThreadsRenderBitExact) {
+    // When
+    HWAudioFormat format{};
+    format.periodSize = kPeriodSize;
+    format.periodCount = 2;
+    RenderEngine threaded{std::make_unique<::testing::NiceMock<MockAudioDeviceManager>>(), format};
+    ASSERT_TRUE(threaded.setWorkerThreads(3));
+    auto bank = makeBank("kick", 1234, kPeriodSize * 6);
+    ASSERT_TRUE(testee_->publishBank(bank));
+    ASSERT_TRUE(threaded.publishBank(bank));
+
+    // Then
+    for (int16_t pitch = -700; pitch <= 700; pitch += 100) {
+        testee_->trigger("kick", static_cast<uint8_t>(60 + pitch / 20), pitch);
+        threaded.trigger("kick", static_cast<uint8_t>(60 + pitch / 20), pitch);
+    }
+
+    // Expect
+    for (auto period = 0; period < 12; ++period) {
+        EXPECT_EQ(toSamples(threaded.renderPeriod()), toSamples(testee_->renderPeriod())) << "period " << period;
+    }
+}
+
+TEST_F(RenderEngineTest, TestGenericLoopsRenderBitExact) {
+    for (uint16_t channels : {1, 2, 3, 6}) {
+        for (auto output : {AudioFormat(48000, channels, false, 16),
+                            AudioFormat(48000, channels, false, 32),
+                            AudioFormat(48000, channels, true, 32)}) {
+            // When
+            HWAudioFormat format{};
+            format.periodSize = kPeriodSize * 8;
+            format.periodCount = 2;
+            format.audioFormat = output;
+            RenderEngine selected{std::make_unique<::testing::NiceMock<MockAudioDeviceManager>>(), format};
+            RenderEngine generic{std::make_unique<::testing::NiceMock<MockAudioDeviceManager>>(), format};
+            generic.useGenericLoops();
+
+            auto pcm = std::make_shared<PCMData>();
+            pcm->format = selected.sampleFormat();
+            const auto frames = format.periodSize * 3;
+            pcm->data.resize(static_cast<size_t>(frames) * channels * sizeof(int16_t));
+            auto* samples = reinterpret_cast<int16_t*>(pcm->data.data());
+            for (size_t i = 0; i < static_cast<size_t>(frames) * channels; ++i) {
+                samples[i] = static_cast<int16_t>((i * 7919) % 65536 - 32768);
+            }
+            Instrument plain{"pcm", SampleBank::instrumentId("pcm"), {}};
+            plain.samples.push_back(Sample{"pcm.wav", {}, pcm, nullptr, frames, frames, 0});
+            Instrument compressed{"adpcm", SampleBank::instrumentId("adpcm"), {}};
+            compressed.samples.push_back(Sample{"adpcm.wav", {}, nullptr, AdpcmCodec::encode(*pcm), frames, frames, 0});
+            auto bank = std::make_shared<const SampleBank>(pcm->format, std::vector<Instrument>{plain, compressed});
+            ASSERT_TRUE(selected.publishBank(bank));
+            ASSERT_TRUE(generic.publishBank(bank));
+
+            // Then
+            for (int16_t pitch = -700; pitch <= 700; pitch += 350) {
+                for (auto instrument : {"pcm", "adpcm"}) {
+                    selected.trigger(instrument, 100, pitch);
+                    generic.trigger(instrument, 100, pitch);
+                }
+            }
+
+            // Expect
+            for (auto period = 0; period < 8; ++period) {
+                EXPECT_EQ(selected.renderPeriod(), generic.renderPeriod())
+                    << channels << " channels, " << output.bitsPerSample << " bits, period " << period;
+            }
+        }
+    }
+}
+
+TEST_F(RenderEngineTest, TestUnsupportedOutputDoesNotStart) {
+    // When
+    HWAudioFormat format{};
+    format.periodSize = kPeriodSize;
+    format.periodCount = 2;
+    format.audioFormat = AudioFormat(48000, 2, false, 24);
+    RenderEngine testee{std::make_unique<::testing::NiceMock<MockAudioDeviceManager>>(), format};
+
+    // Expect
+    EXPECT_FALSE(testee.start());
+}
+
+TEST_F(RenderEngineTest, TestRenderCoreIsChecked) {
+    // Expect
+    EXPECT_TRUE(testee_->setWorkerThreads(3, RenderEngine::kUnpinned));
+    EXPECT_TRUE(testee_->setWorkerThreads(3, 0));
+    EXPECT_FALSE(testee_->setWorkerThreads(3, -3));
+    EXPECT_FALSE(testee_->setWorkerThreads(3, static_cast<int32_t>(std::max(std::thread::hardware_concurrency(), 1u))));
+}
+
+class RenderEngineClockTest : public ::testing::Test {
+
+protected:
+
+    void SetUp() override {
+        format_.periodSize = kPeriodSize;
+        format_.periodCount = 2;
+        auto device = std::make_unique<::testing::NiceMock<MockAudioDeviceManager>>();
+        // a device that plays exactly what has been rendered, queued frames are zero
+        ON_CALL(*device, getTimestamp).WillByDefault([this](uint32_t& available, timespec& time) {
+            auto ns = timeOf(static_cast<int64_t>(periods_++) * kPeriodSize);
+            time = timespec{static_cast<time_t>(ns / 1000000000), static_cast<long>(ns % 1000000000)};
+            available = kPeriodSize * format_.periodCount;
+            return true;
+        });
+        testee_ = std::make_unique<RenderEngine>(std::move(device), format_);
+        ASSERT_TRUE(testee_->publishBank(makeBank("hat", 1000, kPeriodSize)));
+        // lock the frame clock
+        for (size_t period = 0; period < FrameClock::kMinSamples; ++period) {
+            testee_->renderPeriod();
+        }
+    }
+
+    int64_t timeOf(int64_t frame) const {
+        return 1000000000 + frame * 1000000000 / format_.audioFormat.sampleRate;
+    }
+
+    // a trigger that is due at frame of the period about to be rendered
+    int64_t triggerTimeFor(int64_t frame) const {
+        return timeOf(static_cast<int64_t>(periods_) * kPeriodSize + frame - testee_->triggerLatency()) + 1;
+    }
+
+    HWAudioFormat format_{};
+    uint32_t periods_{0};
+    std::unique_ptr<RenderEngine> testee_;
+};
+
+TEST_F(RenderEngineClockTest, TestTimestampedTriggerStartsInsidePeriod) {
+    // When
+    testee_->trigger("hat", 127, 0, triggerTimeFor(1));
+
+    // Then
+    auto period = toSamples(testee_->renderPeriod());
+
+    // Expect
+    EXPECT_EQ(period, (std::vector<int16_t>{0, 0, 999, 999, 999, 999, 999, 999}));
+    EXPECT_EQ(testee_->lateTriggers(), 0);
+}
+
+TEST_F(RenderEngineClockTest, TestTimestampedTriggerWaitsForItsPeriod) {
+    // When
+    testee_->trigger("hat", 127, 0, triggerTimeFor(kPeriodSize + 3));
+
+    // Then
+    auto first = toSamples(testee_->renderPeriod());
+    auto second = toSamples(testee_->renderPeriod());
+
+    // Expect
+    EXPECT_EQ(first, std::vector<int16_t>(kPeriodSize * 2, 0));
+    EXPECT_EQ(second, (std::vector<int16_t>{0, 0, 0, 0, 0, 0, 999, 999}));
+}
+
+TEST_F(RenderEngineClockTest, TestLateTriggerStartsAtOnce) {
+    // When
+    testee_->trigger("hat", 127, 0, triggerTimeFor(-2));
+
+    // Then
+    auto period = toSamples(testee_->renderPeriod());
+
+    // Expect
+    EXPECT_EQ(period, std::vector<int16_t>(kPeriodSize * 2, 999));
+    EXPECT_EQ(testee_->lateTriggers(), 1);
+}
+
+TEST_F(RenderEngineTest, TestFloatOutputFromSixteenBitBank) {
+    // When
+    HWAudioFormat format{};
+    format.periodSize = kPeriodSize;
+    format.periodCount = 2;
+    format.audioFormat = AudioFormat(44100, 2, true, 32);
+    RenderEngine testee{std::make_unique<::testing::NiceMock<MockAudioDeviceManager>>(), format};
+    ASSERT_TRUE(testee.publishBank(makeBank("kick", 16384, kPeriodSize)));
+
+    // Then
+    testee.trigger("kick", 127);
+    const auto& period = testee.renderPeriod();
+
+    // Expect
+    ASSERT_EQ(period.size(), kPeriodSize * 2 * sizeof(float));
+    std::vector<float> samples(kPeriodSize * 2);
+    std::memcpy(samples.data(), period.data(), period.size());
+    for (auto sample : samples) {
+        EXPECT_NEAR(sample, 0.5f, 1e-4f);
+    }
+}
+
+TEST_F(RenderEngineTest, TestFailingDeviceDropsPeriodsAtPeriodRate) {
+    // When
+    HWAudioFormat format{};
+    format.periodSize = 441;    // 10 ms
+    format.periodCount = 2;
+    auto device = std::make_unique<::testing::NiceMock<MockAudioDeviceManager>>();
+    ON_CALL(*device, writeData(::testing::_)).WillByDefault(::testing::Return(false));
+    RenderEngine testee{std::move(device), format};
+
+    // Then
+    ASSERT_TRUE(testee.start());
+    std::this_thread::sleep_for(std::chrono::milliseconds(100));
+    testee.stop();
+
+    // Expect
+    // about one per period instead of as fast as the thread can spin
+    EXPECT_GE(testee.droppedPeriods(), 1);
+    EXPECT_LE(testee.droppedPeriods(), 20);
+}
@@ -0,0 +1,89 @@
+#include <gtest/gtest.h>
+
+#include <cstring>
+#include <vector>
+
+#include "rpi_sound/render_pipeline.hpp"
+
+namespace {
+    constexpr uint32_t kFrames{100};
+    constexpr uint32_t kBuffers{3};
+
+    template <uint16_t Channels>
+    void mixBuffers(uint16_t channels, std::vector<int32_t>& buffers) {
+        const auto samples = static_cast<size_t>(kFrames) * channels;
+        std::vector<int16_t> voice(samples);
+        for (size_t i = 0; i < samples; ++i) {
+            voice[i] = static_cast<int16_t>((i * 7919) % 65536 - 32768);
+        }
+        buffers.assign(samples * kBuffers, 0);
+        for (uint32_t buffer = 0; buffer < kBuffers; ++buffer) {
+            RenderPipeline::mix<Channels>(voice.data(), channels, kFrames, 20000 + static_cast<int32_t>(buffer) * 4000,
+                                          buffers.data() + buffer * samples);
+        }
+    }
+
+    template <typename Sample>
+    std::vector<uint8_t> sum(const std::vector<int32_t>& buffers) {
+        const auto samples = buffers.size() / kBuffers;
+        std::vector<uint8_t> out(samples * sizeof(Sample));
+        RenderPipeline::sum<Sample>(buffers.data(), samples, kBuffers, 0, samples, out.data());
+        return out;
+    }
+
+    std::vector<uint8_t> sumGeneric(const AudioFormat& format, const std::vector<int32_t>& buffers) {
+        const auto samples = buffers.size() / kBuffers;
+        std::vector<uint8_t> out(samples * format.bitsPerSample / 8);
+        RenderPipeline::sumGeneric(format, buffers.data(), samples, kBuffers, 0, samples, out.data());
+        return out;
+    }
+
+    template <uint16_t Channels>
+    void expectMatchesGeneric() {
+        // When
+        std::vector<int32_t> generic;
+        std::vector<int32_t> specialized;
+        mixBuffers<0>(Channels, generic);
+        mixBuffers<Channels>(Channels, specialized);
+
+        // Then
+        ASSERT_EQ(generic, specialized) << Channels << " channels";
+
+        // Expect
+        EXPECT_EQ(sumGeneric(AudioFormat(48000, Channels, false, 16), generic), sum<int16_t>(specialized));
+        EXPECT_EQ(sumGeneric(AudioFormat(48000, Channels, false, 32), generic), sum<int32_t>(specialized));
+        EXPECT_EQ(sumGeneric(AudioFormat(48000, Channels, true, 32), generic), sum<float>(specialized));
+    }
+}
+
+TEST(RenderPipelineTest, TestSpecializedMatchesGeneric) {
+    expectMatchesGeneric<1>();
+    expectMatchesGeneric<2>();
+    expectMatchesGeneric<6>();
+}
+
+TEST(RenderPipelineTest, TestOutputScaling) {
+    // When
+    std::vector<int32_t> mix{16384, -40000};
+    int32_t asInt32[2];
+    float asFloat[2];
+
+    // Then
+    RenderPipeline::sum<int32_t>(mix.data(), 2, 1, 0, 2, reinterpret_cast<uint8_t*>(asInt32));
+    RenderPipeline::sum<float>(mix.data(), 2, 1, 0, 2, reinterpret_cast<uint8_t*>(asFloat));
+
+    // Expect
+    EXPECT_EQ(asInt32[0], 1 << 30);
+    EXPECT_EQ(asInt32[1], INT32_MIN);
+    EXPECT_FLOAT_EQ(asFloat[0], 0.5f);
+    EXPECT_FLOAT_EQ(asFloat[1], -1.0f);
+}
+
+TEST(RenderPipelineTest, TestOutputOfFormat) {
+    // Expect
+    EXPECT_EQ(RenderPipeline::outputOf(AudioFormat(48000, 2, false, 16)), RenderPipeline::Output::kInt16);
+    EXPECT_EQ(RenderPipeline::outputOf(AudioFormat(48000, 2, false, 32)), RenderPipeline::Output::kInt32);
+    EXPECT_EQ(RenderPipeline::outputOf(AudioFormat(48000, 2, true, 32)), RenderPipeline::Output::kFloat);
+    EXPECT_EQ(RenderPipeline::outputOf(AudioFormat(48000, 2, false, 24)), RenderPipeline::Output::kUnsupported);
+    EXPECT_EQ(RenderPipeline::outputOf(AudioFormat(48000, 2, true, 64)), RenderPipeline::Output::kUnsupported);
+}
@@ -0,0 +1,149 @@
+#include <gtest/gtest.h>
+
+#include <atomic>
+#include <chrono>
+#include <thread>
+#include <vector>
+
+#include <pthread.h>
+#include <sched.h>
+
+#include "rpi_sound/worker_pool.hpp"
+
+namespace {
+    constexpr uint32_t kThreads{3};
+    constexpr uint32_t kTasks{37};
+
+    struct Batch {
+        std::vector<std::atomic<uint32_t>> runs = std::vector<std::atomic<uint32_t>>(kTasks);
+        std::vector<uint32_t> workers = std::vector<uint32_t>(kTasks);
+    };
+
+    void countRun(void* context, uint32_t task, uint32_t worker) {
+        auto* batch = static_cast<Batch*>(context);
+        batch->runs[task].fetch_add(1);
+        batch->workers[task] = worker;
+    }
+
+    struct Affinities {
+        cpu_set_t expected;
+        std::vector<uint32_t> workers = std::vector<uint32_t>(kTasks);
+        std::vector<bool> isExpected = std::vector<bool>(kTasks);
+    };
+
+    void checkAffinity(void* context, uint32_t task, uint32_t worker) {
+        auto* affinities = static_cast<Affinities*>(context);
+        cpu_set_t set;
+        CPU_ZERO(&set);
+        pthread_getaffinity_np(pthread_self(), sizeof(set), &set);
+        affinities->workers[task] = worker;
+        affinities->isExpected[task] = CPU_EQUAL(&set, &affinities->expected);
+    }
+}
+
+class WorkerPoolTest : public ::testing::Test {
+
+protected:
+
+    void SetUp() override {
+        testee_ = std::make_unique<WorkerPool>(kThreads, std::chrono::milliseconds(1));
+    }
+
+    std::unique_ptr<WorkerPool> testee_;
+};
+
+TEST_F(WorkerPoolTest, TestEveryTaskRunsOnce) {
+    for (auto round = 0; round < 500; ++round) {
+        // When
+        Batch batch;
+
+        // Then
+        testee_->run(kTasks, countRun, &batch);
+
+        // Expect
+        for (uint32_t task = 0; task < kTasks; ++task) {
+            ASSERT_EQ(batch.runs[task].load(), 1) << "round " << round << " task " << task;
+            ASSERT_LE(batch.workers[task], kThreads);
+        }
+    }
+}
+
+TEST_F(WorkerPoolTest, TestCallerStealsFromSleepingWorkers) {
+    // When
+    Batch first;
+    testee_->run(kTasks, countRun, &first);
+    // the workers are asleep until shortly before the next period is due
+    std::this_thread::sleep_for(std::chrono::microseconds(300));
+    Batch second;
+
+    // Then
+    testee_->run(kTasks, countRun, &second);
+
+    // Expect
+    for (uint32_t task = 0; task < kTasks; ++task) {
+        EXPECT_EQ(second.runs[task].load(), 1);
+    }
+}
+
+TEST_F(WorkerPoolTest, TestParkedWorkersWakeForLateBatch) {
+    // When
+    Batch first;
+    testee_->run(kTasks, countRun, &first);
+    // long past the period, all workers are parked
+    std::this_thread::sleep_for(std::chrono::milliseconds(20));
+    Batch second;
+
+    // Then
+    testee_->run(kTasks, countRun, &second);
+
+    // Expect
+    for (uint32_t task = 0; task < kTasks; ++task) {
+        EXPECT_EQ(second.runs[task].load(), 1);
+    }
+}
+
+TEST(WorkerPoolNoThreadsTest, TestCallerRunsEverything) {
+    // When
+    WorkerPool testee{0, std::chrono::nanoseconds{0}};
+    Batch batch;
+
+    // Then
+    testee.run(kTasks, countRun, &batch);
+
+    // Expect
+    for (uint32_t task = 0; task < kTasks; ++task) {
+        EXPECT_EQ(batch.runs[task].load(), 1);
+        EXPECT_EQ(batch.workers[task], 0);
+    }
+}
+
+TEST(WorkerPoolCoreTest, TestWorkersFollowCallerCore) {
+    // When
+    constexpr uint32_t kCores{4};
+    constexpr uint32_t kCallerCore{3};
+
+    // Then
+    std::vector<uint32_t> cores;
+    for (uint32_t worker = 1; worker < kCores; ++worker) {
+        cores.push_back(WorkerPool::coreOf(worker, kCallerCore, kCores));
+    }
+
+    // Expect
+    EXPECT_EQ(cores, (std::vector<uint32_t>{0, 1, 2}));
+}
+
+TEST(WorkerPoolCoreTest, TestUnpinnedKeepsAffinity) {
+    // When
+    Affinities affinities;
+    CPU_ZERO(&affinities.expected);
+    ASSERT_EQ(pthread_getaffinity_np(pthread_self(), sizeof(affinities.expected), &affinities.expected), 0);
+    WorkerPool testee{kThreads, std::chrono::nanoseconds{0}, WorkerPool::kUnpinned};
+
+    // Then
+    testee.run(kTasks, checkAffinity, &affinities);
+
+    // Expect
+    for (uint32_t task = 0; task < kTasks; ++task) {
+        EXPECT_TRUE(affinities.isExpected[task]) << "worker " << affinities.workers[task];
+    }
+}